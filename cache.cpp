@@ -0,0 +1,178 @@
+#include "cache.h"
+
+#include "config.h"
+#include "perf.h"
+#include "utils.h"
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+static const char RECORD_MAGIC[] = "ytui-rc 2";
+static const size_t RECORD_FIELDS = 8;
+
+static std::string trim_copy(const std::string &s) {
+  size_t b = 0, e = s.size();
+  while (b < e && isspace((unsigned char)s[b]))
+    ++b;
+  while (e > b && isspace((unsigned char)s[e - 1]))
+    --e;
+  return s.substr(b, e - b);
+}
+
+static bool starts_with(const std::string &s, const char *prefix) {
+  return s.compare(0, strlen(prefix), prefix) == 0;
+}
+
+static std::string record_path(const std::string &key) {
+  // FNV-1a keeps file names short and filesystem-safe.
+  uint64_t h = 1469598103934665603ull;
+  for (unsigned char c : key) {
+    h ^= c;
+    h *= 1099511628211ull;
+  }
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.rc", (unsigned long long)h);
+  return RESULT_CACHE + '/' + name;
+}
+
+std::string cache_key_for_query(const std::string &query) {
+  std::string out = "q:";
+  bool space = false;
+  for (char c : trim_copy(query)) {
+    if (isspace((unsigned char)c)) {
+      space = true;
+      continue;
+    }
+    if (space)
+      out += ' ';
+    space = false;
+    out += (char)tolower((unsigned char)c);
+  }
+  return out;
+}
+
+std::string cache_key_for_channel(const std::string &url) {
+  std::string u = trim_copy(url);
+  if (starts_with(u, "http://"))
+    u.replace(0, 7, "https://");
+  if (starts_with(u, "https://youtube.com/") ||
+      starts_with(u, "https://m.youtube.com/")) {
+    size_t host_end = u.find('/', 8);
+    u.replace(8, host_end - 8, "www.youtube.com");
+  }
+  while (!u.empty() && u.back() == '/')
+    u.pop_back();
+  static const std::string videos_tab = "/videos";
+  if (u.size() > videos_tab.size() &&
+      u.compare(u.size() - videos_tab.size(), videos_tab.size(), videos_tab) ==
+          0)
+    u.resize(u.size() - videos_tab.size());
+  return "c:" + u;
+}
+
+static time_t ttl_for_key(const std::string &key) {
+  return starts_with(key, "c:") ? RESULT_CACHE_TTL_CHANNEL
+                                : RESULT_CACHE_TTL_SEARCH;
+}
+
+bool cache_is_stale(const std::string &key, time_t fetched) {
+  return time(nullptr) - fetched >= ttl_for_key(key);
+}
+
+// Record layout:
+//   ytui-rc 1|<fetched>|<esc key>
+//   <id>|<esc title>|<esc channel_url>|<esc channel_name>
+// esc() escapes '|', so a single bar is an unambiguous separator.
+static bool read_record(const std::string &key, std::vector<Video> &out,
+                        time_t *fetched) {
+  std::ifstream f(record_path(key));
+  std::string line;
+  if (!std::getline(f, line))
+    return false;
+  size_t s1 = line.find('|');
+  size_t s2 = s1 == std::string::npos ? s1 : line.find('|', s1 + 1);
+  if (s2 == std::string::npos || line.compare(0, s1, RECORD_MAGIC) != 0)
+    return false;
+  // Hash collisions are possible, so the stored key must match too.
+  if (unesc(line.substr(s2 + 1)) != key)
+    return false;
+  time_t when = (time_t)strtoll(line.c_str() + s1 + 1, nullptr, 10);
+  if (time(nullptr) - when >= RESULT_CACHE_MAX_AGE)
+    return false;
+
+  std::vector<Video> videos;
+  std::string field[RECORD_FIELDS];
+  while (std::getline(f, line)) {
+    size_t n = 0, from = 0;
+    for (; n < RECORD_FIELDS; ++n) {
+      size_t bar = line.find('|', from);
+      field[n] = line.substr(from, bar - from);
+      if (bar == std::string::npos)
+        break;
+      from = bar + 1;
+    }
+    if (n + 1 != RECORD_FIELDS)
+      continue;
+    Video v;
+    v.id = field[0];
+    v.title = unesc(field[1]);
+    v.channel_url = unesc(field[2]);
+    v.channel_name = unesc(field[3]);
+    v.channel_id = unesc(field[4]);
+    v.duration = (uint32_t)strtoul(field[5].c_str(), nullptr, 10);
+    v.upload_date = (uint32_t)strtoul(field[6].c_str(), nullptr, 10);
+    v.view_count = strtoull(field[7].c_str(), nullptr, 10);
+    videos.push_back(v);
+  }
+  if (videos.empty())
+    return false;
+  out = std::move(videos);
+  if (fetched)
+    *fetched = when;
+  return true;
+}
+
+bool cache_load(const std::string &key, std::vector<Video> &out,
+                time_t *fetched) {
+  bool hit = read_record(key, out, fetched);
+  perf_count(hit ? PERF_RESULT_CACHE_HIT : PERF_RESULT_CACHE_MISS);
+  return hit;
+}
+
+void cache_store(const std::string &key, const std::vector<Video> &videos,
+                 time_t fetched) {
+  if (videos.empty())
+    return;
+  mkdir(CACHE_DIR.c_str(), 0755);
+  mkdir(RESULT_CACHE.c_str(), 0755);
+  std::string path = record_path(key);
+  // Stores can race between background refreshes; a per-thread temp name
+  // plus rename keeps readers from ever seeing a torn record.
+  std::string tmp =
+      path + ".tmp" +
+      std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+  {
+    std::ofstream f(tmp, std::ios::trunc);
+    f << RECORD_MAGIC << '|' << (long long)fetched << '|' << esc(key)
+      << '\n';
+    for (const auto &v : videos)
+      f << v.id.c_str() << '|' << esc(v.title) << '|' << esc(v.channel_url) << '|'
+        << esc(v.channel_name) << '|' << esc(v.channel_id) << '|'
+        << v.duration << '|' << v.upload_date << '|' << v.view_count << '\n';
+    if (!f) {
+      f.close();
+      unlink(tmp.c_str());
+      return;
+    }
+  }
+  if (rename(tmp.c_str(), path.c_str()) != 0)
+    unlink(tmp.c_str());
+}
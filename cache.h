@@ -0,0 +1,29 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+// Persistent result cache for searches and channel listings, stored under
+// RESULT_CACHE as one small record file per key.
+
+std::string cache_key_for_query(const std::string &query);
+std::string cache_key_for_channel(const std::string &url);
+
+// Loads the record for key. Returns false on a miss or an expired record;
+// on success *fetched receives the time the listing was fetched.
+bool cache_load(const std::string &key, std::vector<Video> &out,
+                time_t *fetched = nullptr);
+// Writes videos as the record for key, fetched at `fetched`. Does nothing
+// for an empty list.
+void cache_store(const std::string &key, const std::vector<Video> &videos,
+                 time_t fetched = time(nullptr));
+
+// True when a record fetched at `fetched` is past its TTL and should be
+// revalidated in the background.
+bool cache_is_stale(const std::string &key, time_t fetched);
+
+#endif
@@ -0,0 +1,254 @@
+#include "catalog.h"
+
+#include "chanmap.h"
+#include "config.h"
+#include "persist.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <string>
+#include <sys/stat.h>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+const size_t YT_ID_LEN = 11;
+const size_t RECORD_FIELDS = 11;
+
+std::unordered_map<VideoId, CatalogEntry> g_entries;
+std::unordered_map<VideoId, Video> g_expected; // queued downloads
+VideoList g_videos; // g_entries, newest first
+struct timespec g_dir_mtime = {0, 0};
+bool g_loaded = false;
+bool g_scanned = false;
+// The mtime was too recent to rely on; see catalog_sync().
+bool g_racy = false;
+
+const std::array<const char *, 2> VIDEO_EXT = {"mkv", "mp4"};
+
+bool is_video_file(const std::string &name) {
+  size_t dot = name.rfind('.');
+  if (dot == std::string::npos)
+    return false;
+  const char *ext = name.c_str() + dot + 1;
+  return std::any_of(VIDEO_EXT.begin(), VIDEO_EXT.end(),
+                     [&](const char *e) { return strcmp(ext, e) == 0; });
+}
+
+// yt-dlp names files "<title><id>.<ext>".
+std::string_view base_name(const std::string &name) {
+  return std::string_view(name).substr(0, name.rfind('.'));
+}
+
+VideoId id_of(std::string_view base) {
+  return base.size() >= YT_ID_LEN ? base.substr(base.size() - YT_ID_LEN)
+                                  : base;
+}
+
+// Paths are stored relative to VIDEO_CACHE so the cache can be moved.
+std::string file_name(std::string_view p) {
+  size_t slash = p.rfind('/');
+  return std::string(slash == std::string_view::npos ? p
+                                                     : p.substr(slash + 1));
+}
+
+// esc(id)|title|channel_url|channel_name|channel_id|duration|upload_date|
+// views|size|completed|file, all text fields escaped.
+std::string record_line(const CatalogEntry &e) {
+  const Video &v = e.v;
+  std::string out = esc(v.id.view());
+  for (std::string_view s :
+       {v.title.view(), v.channel_url.view(), v.channel_name.view(),
+        v.channel_id.view()}) {
+    out += '|';
+    out += esc(s);
+  }
+  for (unsigned long long n :
+       {(unsigned long long)v.duration, (unsigned long long)v.upload_date,
+        (unsigned long long)v.view_count, (unsigned long long)e.size,
+        (unsigned long long)e.completed}) {
+    out += '|';
+    out += std::to_string(n);
+  }
+  out += '|';
+  out += esc(file_name(v.path));
+  out += '\n';
+  return out;
+}
+
+bool parse_record(const std::string &line, CatalogEntry &e) {
+  std::string field[RECORD_FIELDS];
+  size_t from = 0;
+  for (size_t n = 0; n < RECORD_FIELDS; ++n) {
+    size_t bar = line.find('|', from);
+    if ((bar == std::string::npos) != (n == RECORD_FIELDS - 1))
+      return false;
+    field[n] = line.substr(from, bar - from);
+    from = bar + 1;
+  }
+  Video &v = e.v;
+  v.id = unesc(field[0]);
+  v.title = unesc(field[1]);
+  v.channel_url = unesc(field[2]);
+  v.channel_name = unesc(field[3]);
+  v.channel_id = unesc(field[4]);
+  v.duration = (uint32_t)strtoul(field[5].c_str(), nullptr, 10);
+  v.upload_date = (uint32_t)strtoul(field[6].c_str(), nullptr, 10);
+  v.view_count = strtoull(field[7].c_str(), nullptr, 10);
+  e.size = strtoull(field[8].c_str(), nullptr, 10);
+  e.completed = (time_t)strtoll(field[9].c_str(), nullptr, 10);
+  v.path = VIDEO_CACHE + '/' + unesc(field[10]);
+  return !v.id.empty();
+}
+
+void rewrite() {
+  std::string out;
+  for (const auto &e : g_entries)
+    out += record_line(e.second);
+  persist_replace(DOWNLOAD_CATALOG, [out = std::move(out)] { return out; });
+}
+
+void rebuild_videos() {
+  std::vector<const CatalogEntry *> order;
+  order.reserve(g_entries.size());
+  for (const auto &e : g_entries)
+    order.push_back(&e.second);
+  std::sort(order.begin(), order.end(),
+            [](const CatalogEntry *a, const CatalogEntry *b) {
+              if (a->completed != b->completed)
+                return a->completed > b->completed;
+              return a->v.title.view() < b->v.title.view();
+            });
+  std::vector<Video> videos;
+  videos.reserve(order.size());
+  for (const CatalogEntry *e : order)
+    videos.push_back(e->v);
+  g_videos = std::move(videos);
+}
+
+// Metadata for a new file: that of its queued download, or else a title
+// from the file name and whatever the channel map knows about the id.
+CatalogEntry adopt(const VideoId &id, const std::string &name,
+                   const struct stat &st) {
+  CatalogEntry e;
+  auto queued = g_expected.find(id);
+  if (queued != g_expected.end()) {
+    e.v = queued->second;
+    e.completed = time(nullptr);
+    g_expected.erase(queued);
+  } else {
+    std::string_view base = base_name(name);
+    e.v.id = id;
+    e.v.title = base.size() > YT_ID_LEN
+                    ? base.substr(0, base.size() - YT_ID_LEN)
+                    : base;
+    channel_map_fill(e.v);
+    e.completed = st.st_mtime;
+  }
+  e.v.path = VIDEO_CACHE + '/' + name;
+  e.size = (uint64_t)st.st_size;
+  return e;
+}
+
+} // namespace
+
+void catalog_load() { catalog_install(catalog_read()); }
+
+std::vector<CatalogEntry> catalog_read() {
+  std::vector<CatalogEntry> records;
+  std::ifstream f(DOWNLOAD_CATALOG);
+  std::string line;
+  CatalogEntry e;
+  while (std::getline(f, line))
+    if (parse_record(line, e))
+      records.push_back(e);
+  return records;
+}
+
+// Later lines override earlier ones; the file is rewritten on load when
+// overrides make up most of it, and whenever files disappear.
+void catalog_install(std::vector<CatalogEntry> records) {
+  for (auto &e : records) {
+    VideoId id = e.v.id;
+    g_entries[id] = std::move(e);
+  }
+  g_loaded = true;
+  if (records.size() > 2 * g_entries.size() + 256)
+    rewrite();
+  rebuild_videos();
+}
+
+void catalog_sync() {
+  if (!g_loaded)
+    return;
+  struct stat dir;
+  if (stat(VIDEO_CACHE.c_str(), &dir) != 0)
+    dir = {};
+  // Taken before listing, so a rename during the listing shows up as a
+  // change on the next call. Filesystem timestamps can be coarser than the
+  // time between two changes, so an mtime from the last couple of seconds
+  // may yet be shared by a later change and does not count as unchanged.
+  if (g_scanned && !g_racy && dir.st_mtim.tv_sec == g_dir_mtime.tv_sec &&
+      dir.st_mtim.tv_nsec == g_dir_mtime.tv_nsec)
+    return;
+  g_scanned = true;
+  g_dir_mtime = dir.st_mtim;
+  g_racy = dir.st_mtim.tv_sec + 2 > time(nullptr);
+
+  std::unordered_set<VideoId> seen;
+  std::string appended;
+  if (DIR *d = opendir(VIDEO_CACHE.c_str())) {
+    struct dirent *ent;
+    while ((ent = readdir(d)) != nullptr) {
+      if (ent->d_type != DT_REG)
+        continue;
+      std::string name(ent->d_name);
+      if (!is_video_file(name))
+        continue;
+      VideoId id = id_of(base_name(name));
+      seen.insert(id);
+      auto it = g_entries.find(id);
+      if (it != g_entries.end() && file_name(it->second.v.path) == name)
+        continue;
+      struct stat st;
+      if (stat((VIDEO_CACHE + '/' + name).c_str(), &st) != 0)
+        continue;
+      CatalogEntry e = adopt(id, name, st);
+      appended += record_line(e);
+      g_entries[id] = std::move(e);
+    }
+    closedir(d);
+  }
+
+  bool removed = false;
+  for (auto it = g_entries.begin(); it != g_entries.end();) {
+    if (seen.count(it->first)) {
+      ++it;
+    } else {
+      it = g_entries.erase(it);
+      removed = true;
+    }
+  }
+  if (!removed && appended.empty())
+    return;
+  if (removed)
+    rewrite();
+  else
+    persist_append(DOWNLOAD_CATALOG, std::move(appended));
+  rebuild_videos();
+}
+
+void catalog_expect(const Video &v) { g_expected[v.id] = v; }
+
+const CatalogEntry *catalog_find(const VideoId &id) {
+  auto it = g_entries.find(id);
+  return it == g_entries.end() ? nullptr : &it->second;
+}
+
+const VideoList &catalog_videos() { return g_videos; }
@@ -0,0 +1,47 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <cstdint>
+#include <ctime>
+#include <vector>
+
+#include "types.h"
+
+// Index of the files in VIDEO_CACHE, keyed by video id and kept in
+// DOWNLOAD_CATALOG. Each entry holds the metadata the video had when its
+// download was queued, so the DOWNLOADS view shows real titles, channels
+// and sizes rather than names parsed back out of filenames. Files that
+// appear without a queued download (older downloads, copies made by hand)
+// are adopted with a title taken from their name.
+//
+// The directory is only listed again when its mtime changes, which yt-dlp
+// causes when it renames a finished file into place. UI thread only.
+
+struct CatalogEntry {
+  Video v; // v.path is the downloaded file
+  uint64_t size = 0;
+  time_t completed = 0;
+};
+
+void catalog_load();
+// catalog_load() in two steps, so the file can be read off the UI thread:
+// catalog_read() only parses it, and catalog_install() takes the records on
+// the UI thread. catalog_sync() does nothing until the catalog is loaded.
+std::vector<CatalogEntry> catalog_read();
+void catalog_install(std::vector<CatalogEntry> records);
+
+// Bring the catalog in line with VIDEO_CACHE if the directory changed.
+void catalog_sync();
+
+// Remember v's metadata for a download that has just been queued; it is
+// recorded once the file shows up.
+void catalog_expect(const Video &v);
+
+// The entry for id, or nullptr when it has not been downloaded.
+const CatalogEntry *catalog_find(const VideoId &id);
+
+// Downloaded videos, most recently completed first. A new snapshot
+// whenever the catalog changes.
+const VideoList &catalog_videos();
+
+#endif
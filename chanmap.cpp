@@ -0,0 +1,169 @@
+#include "chanmap.h"
+
+#include "config.h"
+#include "persist.h"
+#include "tasks.h"
+#include "utils.h"
+#include "youtube.h"
+
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// An empty url records an id yt-dlp could not resolve; background lookups
+// leave it alone until `retry`.
+struct ChannelRef {
+  Str url, name;
+  time_t retry = 0;
+};
+
+std::mutex g_mu;
+std::unordered_map<VideoId, ChannelRef> g_map;
+std::unordered_set<VideoId> g_pending; // ids with a lookup in flight
+
+std::string map_line(const VideoId &id, const ChannelRef &ch) {
+  if (ch.url.empty())
+    return id.str() + "||" + std::to_string(ch.retry) + '\n';
+  return id.str() + '|' + esc(ch.url) + '|' + esc(ch.name) + '\n';
+}
+
+// Caller holds g_mu. Returns true when the map changed.
+bool note_locked(const Video &v) {
+  if (v.id.empty() || v.channel_url.empty())
+    return false;
+  ChannelRef &ch = g_map[v.id];
+  if (ch.url == v.channel_url &&
+      (v.channel_name.empty() || ch.name == v.channel_name))
+    return false;
+  ch.url = v.channel_url;
+  ch.retry = 0;
+  if (!v.channel_name.empty())
+    ch.name = v.channel_name;
+  persist_append(CHANNEL_MAP_FILE, map_line(v.id, ch));
+  return true;
+}
+
+// Caller holds g_mu. Records a failed lookup unless the id has a channel.
+void note_miss_locked(const VideoId &id, time_t now) {
+  ChannelRef &ch = g_map[id];
+  if (!ch.url.empty())
+    return;
+  ch.retry = now + CHANNEL_MISS_RETRY;
+  persist_append(CHANNEL_MAP_FILE, map_line(id, ch));
+}
+
+} // namespace
+
+// "id|url|name" per line, or "id||retry" for a failed lookup, later lines
+// overriding earlier ones. The file
+// is parsed without holding the lock, and anything noted in the meantime
+// is newer than the file and wins. The file is rewritten when overrides
+// make up most of it.
+void channel_map_load() {
+  std::unordered_map<VideoId, ChannelRef> loaded;
+  std::ifstream f(CHANNEL_MAP_FILE);
+  std::string line;
+  size_t lines = 0;
+  while (std::getline(f, line)) {
+    size_t a = line.find('|');
+    size_t b = a == std::string::npos ? a : line.find('|', a + 1);
+    if (b == std::string::npos)
+      continue;
+    ++lines;
+    ChannelRef &ch = loaded[VideoId(line.substr(0, a))];
+    ch.url = unesc(line.substr(a + 1, b - a - 1));
+    if (ch.url.empty()) {
+      ch.name = Str();
+      ch.retry = std::atoll(line.c_str() + b + 1);
+    } else {
+      ch.name = unesc(line.substr(b + 1));
+      ch.retry = 0;
+    }
+  }
+  std::lock_guard<std::mutex> lock(g_mu);
+  if (g_map.empty())
+    g_map.swap(loaded);
+  else
+    for (auto &e : loaded)
+      g_map.emplace(e.first, std::move(e.second));
+  if (lines > 2 * g_map.size() + 256) {
+    std::string out;
+    for (const auto &e : g_map)
+      out += map_line(e.first, e.second);
+    persist_replace(CHANNEL_MAP_FILE, [out = std::move(out)] { return out; });
+  }
+}
+
+void channel_map_note(const Video &v) {
+  std::lock_guard<std::mutex> lock(g_mu);
+  note_locked(v);
+}
+
+void channel_map_note(const std::vector<Video> &videos) {
+  std::lock_guard<std::mutex> lock(g_mu);
+  for (const auto &v : videos)
+    note_locked(v);
+}
+
+bool channel_map_fill(Video &v) {
+  if (!v.channel_url.empty())
+    return true;
+  std::lock_guard<std::mutex> lock(g_mu);
+  auto it = g_map.find(v.id);
+  if (it == g_map.end() || it->second.url.empty())
+    return false;
+  v.channel_url = it->second.url;
+  if (v.channel_name.empty())
+    v.channel_name = it->second.name;
+  return true;
+}
+
+void channel_map_resolve(const std::vector<VideoId> &ids,
+                         std::function<void()> on_done) {
+  std::vector<VideoId> todo;
+  time_t now = time(nullptr);
+  {
+    std::lock_guard<std::mutex> lock(g_mu);
+    for (const auto &id : ids) {
+      // Only YouTube ids can be looked up. A caller waiting on the result
+      // looks up ids already in flight again rather than tracking waiters,
+      // and retries failed ones, since the failure may have been transient.
+      if (id.size() != 11)
+        continue;
+      auto it = g_map.find(id);
+      if (it != g_map.end() &&
+          (!it->second.url.empty() || (!on_done && now < it->second.retry)))
+        continue;
+      if (!g_pending.insert(id).second && !on_done)
+        continue;
+      todo.push_back(id);
+    }
+  }
+  if (todo.empty()) {
+    if (on_done)
+      on_done();
+    return;
+  }
+  run_async([todo = std::move(todo), on_done = std::move(on_done)] {
+    for (size_t i = 0; i < todo.size(); i += CHANNEL_RESOLVE_BATCH) {
+      size_t end = std::min(todo.size(), i + CHANNEL_RESOLVE_BATCH);
+      std::vector<VideoId> batch(todo.begin() + i, todo.begin() + end);
+      std::vector<Video> found = resolve_video_channels(batch);
+      time_t now = time(nullptr);
+      std::lock_guard<std::mutex> lock(g_mu);
+      for (const auto &v : found)
+        note_locked(v);
+      for (const auto &id : batch) {
+        note_miss_locked(id, now);
+        g_pending.erase(id);
+      }
+    }
+    if (on_done)
+      post_main(on_done);
+  });
+}
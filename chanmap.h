@@ -0,0 +1,33 @@
+#ifndef CHANMAP_H
+#define CHANMAP_H
+
+#include <functional>
+#include <vector>
+
+#include "types.h"
+
+// Persistent video id -> channel map, so entries that carry no channel
+// (history, local files) can still open or subscribe to theirs without a
+// yt-dlp round trip. Every fetched listing feeds it; ids it lacks are
+// resolved in the background, CHANNEL_RESOLVE_BATCH per yt-dlp run. New
+// entries are appended to CHANNEL_MAP_FILE through the persistence thread.
+// All functions are thread-safe.
+
+void channel_map_load();
+
+// Remember the channels of videos that have one.
+void channel_map_note(const Video &v);
+void channel_map_note(const std::vector<Video> &videos);
+
+// Fill v's missing channel fields; false when the channel is not known.
+bool channel_map_fill(Video &v);
+
+// Look up the ids whose channel is unknown and not already being looked
+// up. Ids yt-dlp could not resolve are remembered and skipped for
+// CHANNEL_MISS_RETRY, unless on_done is given: a caller waiting on the
+// result always gets a fresh try. on_done runs on the UI thread once all
+// of them have been tried.
+void channel_map_resolve(const std::vector<VideoId> &ids,
+                         std::function<void()> on_done = nullptr);
+
+#endif
@@ -0,0 +1,163 @@
+#include "complete.h"
+
+#include "config.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+static std::string lower_key(const std::string &s) {
+  std::string k(s);
+  for (char &c : k)
+    c = (char)tolower((unsigned char)c);
+  return k;
+}
+
+// log2(2^a + 2^b) without overflowing for large exponents.
+static double log2_add(double a, double b) {
+  if (a < b)
+    std::swap(a, b);
+  return a + std::log2(1.0 + std::exp2(b - a));
+}
+
+void Completer::clear() {
+  entries_.clear();
+  nodes_.clear();
+  clock_ = 0;
+  cursor_key_.clear();
+  path_.clear();
+}
+
+// Walk or create the path for key, end it at entry, and refresh the best
+// cache of every node on the way. Ties go to the entry being inserted,
+// which is the most recently touched one.
+uint32_t Completer::insert(const std::string &key, uint32_t entry) {
+  if (nodes_.empty())
+    nodes_.emplace_back();
+  double score = entries_[entry].score;
+  uint32_t n = 0;
+  auto improve = [&](uint32_t node) {
+    uint32_t b = nodes_[node].best;
+    if (b == NIL || b == entry || entries_[b].score <= score)
+      nodes_[node].best = entry;
+  };
+  improve(n);
+  for (char c : key) {
+    uint32_t child = nodes_[n].child;
+    while (child != NIL && nodes_[child].c != c)
+      child = nodes_[child].sibling;
+    if (child == NIL) {
+      child = (uint32_t)nodes_.size();
+      Node fresh;
+      fresh.c = c;
+      fresh.sibling = nodes_[n].child;
+      nodes_.push_back(fresh);
+      nodes_[n].child = child;
+    }
+    n = child;
+    improve(n);
+  }
+  nodes_[n].entry = entry;
+  cursor_key_.clear();
+  path_.clear();
+  return n;
+}
+
+void Completer::restore(Entry e) {
+  clock_ = std::max(clock_, e.last + 1);
+  std::string key = lower_key(e.text);
+  entries_.push_back(std::move(e));
+  insert(key, (uint32_t)entries_.size() - 1);
+  evict();
+}
+
+void Completer::use(const std::string &text) {
+  std::string key = lower_key(text);
+  double weight = (double)clock_ / SEARCH_HIST_HALF_LIFE;
+
+  uint32_t n = nodes_.empty() ? NIL : 0;
+  for (size_t i = 0; n != NIL && i < key.size(); ++i) {
+    n = nodes_[n].child;
+    while (n != NIL && nodes_[n].c != key[i])
+      n = nodes_[n].sibling;
+  }
+  uint32_t idx = n != NIL ? nodes_[n].entry : NIL;
+  if (idx == NIL) {
+    idx = (uint32_t)entries_.size();
+    entries_.push_back({text, 1, clock_, weight});
+  } else {
+    Entry &e = entries_[idx];
+    e.text = text;
+    ++e.uses;
+    e.last = clock_;
+    e.score = log2_add(e.score, weight);
+  }
+  ++clock_;
+  insert(key, idx);
+  evict();
+}
+
+// Dropping single entries would mean recomputing caches up the tree, so
+// the trie is rebuilt from the best SEARCH_HIST_MAX entries once it
+// overshoots by an eighth.
+void Completer::evict() {
+  if (entries_.size() <= SEARCH_HIST_MAX + SEARCH_HIST_MAX / 8)
+    return;
+  std::sort(entries_.begin(), entries_.end(),
+            [](const Entry &a, const Entry &b) {
+              return a.score != b.score ? a.score > b.score : a.last > b.last;
+            });
+  entries_.resize(SEARCH_HIST_MAX);
+  // Insert worst first so that equal scores resolve to the later entry.
+  nodes_.clear();
+  for (size_t i = entries_.size(); i-- > 0;)
+    insert(lower_key(entries_[i].text), (uint32_t)i);
+}
+
+const std::string *Completer::complete(const std::string &prefix) {
+  if (nodes_.empty() || prefix.empty())
+    return nullptr;
+  std::string key = lower_key(prefix);
+
+  size_t keep = 0;
+  while (keep < key.size() && keep < cursor_key_.size() &&
+         key[keep] == cursor_key_[keep])
+    ++keep;
+  if (path_.empty())
+    path_.push_back(0);
+  if (path_.size() > keep + 1)
+    path_.resize(keep + 1);
+  // path_ may stop short of keep when the old prefix had no node.
+  for (size_t i = path_.size() - 1; i < key.size(); ++i) {
+    uint32_t n = nodes_[path_.back()].child;
+    while (n != NIL && nodes_[n].c != key[i])
+      n = nodes_[n].sibling;
+    if (n == NIL)
+      break;
+    path_.push_back(n);
+  }
+  cursor_key_ = key;
+
+  if (path_.size() != key.size() + 1)
+    return nullptr;
+  uint32_t best = nodes_[path_.back()].best;
+  if (best == NIL || entries_[best].text.size() <= prefix.size())
+    return nullptr;
+  return &entries_[best].text;
+}
+
+std::vector<std::string> Completer::recent(size_t n) const {
+  std::vector<uint32_t> order(entries_.size());
+  for (uint32_t i = 0; i < order.size(); ++i)
+    order[i] = i;
+  n = std::min(n, order.size());
+  std::partial_sort(order.begin(), order.begin() + n, order.end(),
+                    [&](uint32_t a, uint32_t b) {
+                      return entries_[a].last > entries_[b].last;
+                    });
+  std::vector<std::string> out;
+  out.reserve(n);
+  for (size_t i = 0; i < n; ++i)
+    out.push_back(entries_[order[i]].text);
+  return out;
+}
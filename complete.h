@@ -0,0 +1,67 @@
+#ifndef COMPLETE_H
+#define COMPLETE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Search history with prefix completion. Queries are kept in a byte trie
+// keyed on their lowercased text; every node caches the best-scoring query
+// below it, so the completion for a prefix is the best entry of the node
+// the prefix ends at. complete() keeps the path of the previous prefix and
+// only walks the characters that changed, so typing costs O(1) per key.
+//
+// A query's score is the log2 of the sum of 2^(t / SEARCH_HIST_HALF_LIFE)
+// over the times t it was searched, t counting searches. Frequent queries
+// score high, and a use counts twice as much as one made HALF_LIFE
+// searches earlier. Scores only ever grow, which keeps the node caches
+// valid on update.
+class Completer {
+public:
+  struct Entry {
+    std::string text; // as last typed
+    uint32_t uses;
+    uint64_t last; // clock value of the latest use
+    double score;
+  };
+
+  void clear();
+  size_t size() const { return entries_.size(); }
+  const std::vector<Entry> &entries() const { return entries_; }
+  uint64_t clock() const { return clock_; }
+
+  // Restore a saved entry; the clock moves past its last use.
+  void restore(Entry e);
+  // Record a search for text now.
+  void use(const std::string &text);
+
+  // Best past query extending prefix (case-insensitively), or nullptr when
+  // there is none longer than prefix.
+  const std::string *complete(const std::string &prefix);
+
+  // Up to n queries, most recently used first.
+  std::vector<std::string> recent(size_t n) const;
+
+private:
+  static const uint32_t NIL = UINT32_MAX;
+  struct Node {
+    uint32_t child = NIL, sibling = NIL;
+    uint32_t best = NIL;  // best entry in this subtree
+    uint32_t entry = NIL; // entry ending here
+    char c = 0;
+  };
+
+  uint32_t insert(const std::string &key, uint32_t entry);
+  void evict();
+
+  std::vector<Entry> entries_;
+  std::vector<Node> nodes_;
+  uint64_t clock_ = 0;
+
+  // Cursor for complete(): path_[i] is the node for the first i characters
+  // of cursor_key_, or the path stops short when the prefix has no node.
+  std::string cursor_key_;
+  std::vector<uint32_t> path_;
+};
+
+#endif
@@ -12,9 +12,30 @@ inline const std::string CACHE_DIR =
 inline const std::string VIDEO_CACHE = CACHE_DIR + "/videos";
 inline const std::string THUMBNAIL_CACHE = CACHE_DIR + "/thumbs";
 inline const std::string HISTORY_FILE = CACHE_DIR + "/history.txt";
+inline const std::string HISTORY_JOURNAL = CACHE_DIR + "/history.journal";
 inline const std::string SEARCH_HISTORY_FILE =
     CACHE_DIR + "/search_history.txt";
 inline const std::string SUBS_FILE = CONFIG_DIR + "/subscriptions.txt";
+inline const std::string RESULT_CACHE = CACHE_DIR + "/results";
+inline const std::string CHANNEL_MAP_FILE = CACHE_DIR + "/channels.txt";
+inline const std::string DOWNLOAD_CATALOG = CACHE_DIR + "/downloads.txt";
+inline const std::string PERF_STATS_FILE = CACHE_DIR + "/perf.txt";
+inline const std::string CELL_SIZE_FILE = CACHE_DIR + "/cell_size.txt";
+// Set to a file name to record a Chrome trace there (see trace.h).
+inline const char *TRACE_ENV = "YTUI_TRACE";
+// Set to "kitty", "blocks" or "off" to choose how thumbnails are drawn
+// instead of going by the terminal (see thumb_renderer() in utils.cpp).
+inline const char *THUMBNAILS_ENV = "YTUI_THUMBNAILS";
+
+// External programs, looked up on PATH unless YTUI_YTDLP, YTUI_CURL or
+// YTUI_MPV name another one (such as the ytui-fake stand-ins).
+inline std::string program(const char *env, const char *name) {
+  const char *p = getenv(env);
+  return p && *p ? p : name;
+}
+inline const std::string YTDLP_BIN = program("YTUI_YTDLP", "yt-dlp");
+inline const std::string CURL_BIN = program("YTUI_CURL", "curl");
+inline const std::string MPV_BIN = program("YTUI_MPV", "mpv");
 
 // MPV & yt-dlp configuration
 inline const char *MPV_ARGS =
@@ -36,7 +57,62 @@ static const int APP_KEY_SEARCH = 's';
 static const int APP_KEY_DOWNLOADS = 'd';
 static const int APP_KEY_SUBS = 'w';
 static const int APP_KEY_THUMBNAIL = 't';
+static const int APP_KEY_FEED = 'f';
+static const int APP_KEY_REFRESH_ALL = 'R';
+static const int APP_KEY_FILTER = '/';
+static const int APP_KEY_SORT = 'o';
+static const int APP_KEY_PERF = 'P';
+// Keys handled per main loop iteration at most; the rest wait a frame.
+static const int INPUT_BATCH_KEYS = 64;
+// How long a cell size reply cut short by the end of the input is held
+// back waiting for the rest before its bytes are taken as keys.
+static const int CELL_REPLY_WAIT_MS = 200;
+
+static const int MAX_LIST_ITEMS = 50; // entries per fetched page
+
+// Matches the '/' filter shows at most: the best ones by rank, in list
+// order within a rank. The prompt shows "N+" when more entries matched.
+// Bounds the work per keystroke on long lists.
+static const size_t FILTER_MAX_HITS = 1000;
+
+// Plays journaled before the history snapshot is rewritten.
+static const size_t HISTORY_COMPACT_EVERY = 256;
+
+// Search history: queries kept for completion, how many searches it takes
+// for an older use to count half as much, and the recent list length.
+static const size_t SEARCH_HIST_MAX = 5000;
+static const double SEARCH_HIST_HALF_LIFE = 100.0;
+static const size_t SEARCH_HIST_RECENT = 50;
+
+// How long the persistence thread lets changes pile up before writing.
+static const int PERSIST_DELAY_MS = 250;
+
+// Results and channel lists load the next page in the background once the
+// selection is this close to the end.
+static const size_t PAGE_PREFETCH_MARGIN = 15;
+
+// Subscription "refresh all": parallel channel fetches and the size of
+// each channel's contribution to the merged feed.
+static const int SUBS_REFRESH_CONCURRENCY = 6;
+static const size_t FEED_MAX_PER_CHANNEL = 10;
+
+// Incremental channel refresh: entries fetched before giving up on finding
+// a known upload, and the most entries kept once new ones are prepended.
+static const int CHANNEL_HEAD_WINDOW = 8;
+static const size_t CHANNEL_MAX_KEPT = 4 * MAX_LIST_ITEMS;
+
+// Channel lookups for entries without one: ids per yt-dlp run, how many
+// of the most recent history entries are looked up at startup, and how
+// long an id yt-dlp could not resolve (deleted, private) is left alone by
+// those background lookups.
+static const size_t CHANNEL_RESOLVE_BATCH = 25;
+static const size_t CHANNEL_PREFETCH_RECENT = 100;
+static const long CHANNEL_MISS_RETRY = 24 * 60 * 60;
 
-static const int MAX_LIST_ITEMS = 50;
+// Result cache: entries older than the TTL are shown immediately and
+// refreshed in the background; entries past MAX_AGE are ignored.
+static const long RESULT_CACHE_TTL_SEARCH = 60 * 60;
+static const long RESULT_CACHE_TTL_CHANNEL = 20 * 60;
+static const long RESULT_CACHE_MAX_AGE = 14 * 24 * 60 * 60;
 
 #endif
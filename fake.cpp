@@ -0,0 +1,372 @@
+// Stand-ins for yt-dlp, curl and mpv, so ytui can be run and measured
+// offline and deterministically. It is one binary that acts as the program
+// it was invoked as; `make fakes` links fake-bin/yt-dlp, fake-bin/curl and
+// fake-bin/mpv to it. Put fake-bin first on PATH, or point YTUI_YTDLP,
+// YTUI_CURL and YTUI_MPV at the links.
+//
+// Everything returned is derived from the arguments, so runs repeat. A
+// video id encodes its channel, so listings, channel lookups and downloads
+// agree with each other. Tunables, from the environment:
+//
+//   YTUI_FAKE_DELAY_MS  latency before any output (default 0)
+//   YTUI_FAKE_RATE      output throughput in bytes/s, 0 for unlimited (0)
+//   YTUI_FAKE_FAIL      probability in [0,1] that a call fails (0)
+//   YTUI_FAKE_RESULTS   entries in a search or channel listing (500)
+//   YTUI_FAKE_DOWNLOAD  size of a downloaded video in bytes (8 MiB)
+//   YTUI_FAKE_SEED      changes every generated value (0)
+
+#include "fakedata.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <jpeglib.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+uint64_t env_u64(const char *name, uint64_t fallback) {
+  const char *v = getenv(name);
+  return v && *v ? strtoull(v, nullptr, 10) : fallback;
+}
+
+uint64_t g_seed = 0;
+
+uint64_t mix(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ull;
+  return h ^ (h >> 33);
+}
+
+uint64_t hash(const std::string &s, uint64_t n = 0) {
+  uint64_t h = 1469598103934665603ull ^ g_seed;
+  for (unsigned char c : s) {
+    h ^= c;
+    h *= 1099511628211ull;
+  }
+  return mix(h ^ mix(n));
+}
+
+void sleep_ms(uint64_t ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+// Writes to fd no faster than YTUI_FAKE_RATE.
+class Output {
+public:
+  explicit Output(int fd) : fd_(fd), rate_(env_u64("YTUI_FAKE_RATE", 0)) {
+    start_ = std::chrono::steady_clock::now();
+  }
+
+  void write(const std::string &s) { write(s.data(), s.size()); }
+  void write(const char *p, size_t n) {
+    while (n > 0) {
+      size_t chunk = rate_ ? std::min(n, (size_t)4096) : n;
+      pace(chunk);
+      ssize_t w = ::write(fd_, p, chunk);
+      if (w <= 0)
+        exit(1);
+      p += w;
+      n -= (size_t)w;
+      sent_ += (uint64_t)w;
+    }
+  }
+
+private:
+  void pace(size_t next) {
+    if (!rate_)
+      return;
+    double due = (double)(sent_ + next) / (double)rate_;
+    double now = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start_)
+                     .count();
+    if (due > now)
+      std::this_thread::sleep_for(std::chrono::duration<double>(due - now));
+  }
+
+  int fd_;
+  uint64_t rate_, sent_ = 0;
+  std::chrono::steady_clock::time_point start_;
+};
+
+// A channel URL made by fake_channel_url() maps back to its channel; any
+// other source gets one by hash.
+unsigned channel_of_source(const std::string &source) {
+  unsigned n = 0;
+  size_t at = source.find("UCytuifakechan");
+  if (at != std::string::npos &&
+      sscanf(source.c_str() + at, "UCytuifakechan%10u", &n) == 1)
+    return n % FAKE_CHANNELS;
+  return (unsigned)(hash(source) % FAKE_CHANNELS);
+}
+
+std::string title_of(const std::string &id) {
+  uint64_t h = hash(id, 1);
+  size_t count = 4 + h % 7;
+  std::string t;
+  for (size_t i = 0; i < count; ++i) {
+    h = mix(h + i);
+    if (!t.empty())
+      t += ' ';
+    t += FAKE_TITLE_WORDS[h % FAKE_TITLE_WORD_COUNT];
+  }
+  t[0] = (char)toupper((unsigned char)t[0]);
+  return t + " #" + std::to_string(hash(id, 2) % 1000);
+}
+
+std::string json_escape(const std::string &s) {
+  std::string out;
+  for (char c : s) {
+    if (c == '"' || c == '\\')
+      out += '\\';
+    out += c;
+  }
+  return out;
+}
+
+bool should_fail(const std::string &key) {
+  const char *p = getenv("YTUI_FAKE_FAIL");
+  double rate = p ? atof(p) : 0;
+  return rate > 0 && (double)(hash(key, 3) % 1000000) / 1e6 < rate;
+}
+
+std::string joined(int argc, char **argv) {
+  std::string s;
+  for (int i = 1; i < argc; ++i)
+    (s += argv[i]) += '\x1f';
+  return s;
+}
+
+std::string id_from_url(const std::string &url) {
+  size_t v = url.find("v=");
+  if (v != std::string::npos)
+    return url.substr(v + 2, 11);
+  size_t vi = url.find("/vi/");
+  return vi == std::string::npos ? "" : url.substr(vi + 4, 11);
+}
+
+// yt-dlp --flat-playlist -j -I a:b SOURCE, where SOURCE is a channel URL
+// or "ytsearchN:query".
+void ytdlp_listing(const std::vector<std::string> &args, Output &out) {
+  size_t from = 1, to = SIZE_MAX;
+  for (size_t i = 0; i + 1 < args.size(); ++i)
+    if (args[i] == "-I")
+      sscanf(args[i + 1].c_str(), "%zu:%zu", &from, &to);
+  std::string source = args.empty() ? "" : args.back();
+  size_t total = env_u64("YTUI_FAKE_RESULTS", 500);
+  bool search = source.compare(0, 8, "ytsearch") == 0;
+  if (search && source.find(':') != std::string::npos) {
+    total = std::min<size_t>(total, strtoull(source.c_str() + 8, nullptr, 10));
+    source = source.substr(source.find(':') + 1);
+  }
+  unsigned listed_channel = channel_of_source(source);
+
+  for (size_t i = std::max<size_t>(from, 1); i <= std::min(to, total); ++i) {
+    uint64_t h = hash(source, i);
+    unsigned ch = search ? (unsigned)(h % FAKE_CHANNELS) : listed_channel;
+    std::string id = fake_video_id(ch, h >> 12);
+    // Channel uploads are listed newest first, a day apart.
+    unsigned days = search ? (unsigned)(mix(h) % 5000) : (unsigned)i;
+    time_t when = 1767225600 - (time_t)days * 86400; // 2026-01-01
+    struct tm tm;
+    gmtime_r(&when, &tm);
+    char line[1024];
+    snprintf(line, sizeof(line),
+             "{\"_type\": \"url\", \"ie_key\": \"Youtube\", \"id\": \"%s\", "
+             "\"url\": \"https://www.youtube.com/watch?v=%s\", \"title\": "
+             "\"%s\", \"description\": null, \"duration\": %llu.0, "
+             "\"channel_id\": \"%s\", \"channel\": \"%s\", \"channel_url\": "
+             "\"%s\", \"view_count\": %llu, \"upload_date\": "
+             "\"%04d%02d%02d\"}\n",
+             id.c_str(), id.c_str(), json_escape(title_of(id)).c_str(),
+             (unsigned long long)(30 + h % 5400), fake_channel_id(ch).c_str(),
+             json_escape(fake_channel_name(ch)).c_str(),
+             fake_channel_url(ch).c_str(),
+             (unsigned long long)(mix(h ^ 7) % 50000000), tm.tm_year + 1900,
+             tm.tm_mon + 1, tm.tm_mday);
+    out.write(line);
+  }
+}
+
+// yt-dlp --skip-download --print TEMPLATE URL...
+void ytdlp_print(const std::vector<std::string> &args, Output &out) {
+  std::string tmpl = "%(id)s";
+  for (size_t i = 0; i + 1 < args.size(); ++i)
+    if (args[i] == "--print")
+      tmpl = args[i + 1];
+  for (const auto &a : args) {
+    if (a.find("watch?v=") == std::string::npos)
+      continue;
+    std::string id = id_from_url(a);
+    if (should_fail(id))
+      continue;
+    unsigned ch = fake_channel_of_id(id);
+    std::string line = tmpl;
+    auto put = [&](const char *field, const std::string &value) {
+      for (size_t at; (at = line.find(field)) != std::string::npos;)
+        line.replace(at, strlen(field), value);
+    };
+    put("%(id)s", id);
+    put("%(channel_url)s", fake_channel_url(ch));
+    put("%(channel)s", fake_channel_name(ch));
+    put("%(title)s", title_of(id));
+    out.write(line + "\n");
+  }
+}
+
+// yt-dlp -o TEMPLATE URL: writes TEMPLATE.part at the configured rate and
+// renames it into place, as yt-dlp does.
+int ytdlp_download(const std::vector<std::string> &args) {
+  std::string tmpl, url;
+  for (size_t i = 0; i < args.size(); ++i) {
+    if (args[i] == "-o" && i + 1 < args.size())
+      tmpl = args[++i];
+    else if (args[i].find("watch?v=") != std::string::npos)
+      url = args[i];
+  }
+  std::string id = id_from_url(url);
+  if (tmpl.empty() || id.empty())
+    return 2;
+  std::string title = restricted_filename(title_of(id));
+  std::string path = tmpl;
+  for (size_t at; (at = path.find("%(title)s")) != std::string::npos;)
+    path.replace(at, 9, title);
+  for (size_t at; (at = path.find("%(id)s")) != std::string::npos;)
+    path.replace(at, 6, id);
+  std::string part = path + ".part";
+  FILE *f = fopen(part.c_str(), "wb");
+  if (!f)
+    return 1;
+  Output out(fileno(f));
+  std::vector<char> block(1 << 16);
+  for (size_t i = 0; i < block.size(); ++i)
+    block[i] = (char)(hash(id, i / 64) & 0xff);
+  uint64_t left = env_u64("YTUI_FAKE_DOWNLOAD", 8u << 20);
+  while (left > 0) {
+    size_t n = (size_t)std::min<uint64_t>(left, block.size());
+    out.write(block.data(), n);
+    left -= n;
+  }
+  fclose(f);
+  return rename(part.c_str(), path.c_str()) == 0 ? 0 : 1;
+}
+
+int ytdlp(const std::vector<std::string> &args) {
+  auto has = [&](const char *flag) {
+    return std::find(args.begin(), args.end(), flag) != args.end();
+  };
+  Output out(STDOUT_FILENO);
+  if (has("--flat-playlist"))
+    ytdlp_listing(args, out);
+  else if (has("--skip-download"))
+    ytdlp_print(args, out);
+  else
+    return ytdlp_download(args);
+  return 0;
+}
+
+// A thumbnail-sized JPEG coloured after the video id.
+std::string make_jpeg(const std::string &id, unsigned w, unsigned h) {
+  struct jpeg_compress_struct cinfo = {};
+  struct jpeg_error_mgr jerr = {};
+  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_compress(&cinfo);
+  unsigned char *buf = nullptr;
+  unsigned long size = 0;
+  jpeg_mem_dest(&cinfo, &buf, &size);
+  cinfo.image_width = w;
+  cinfo.image_height = h;
+  cinfo.input_components = 3;
+  cinfo.in_color_space = JCS_RGB;
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, 85, TRUE);
+  jpeg_start_compress(&cinfo, TRUE);
+  uint64_t c = hash(id, 4);
+  std::vector<uint8_t> row(w * 3);
+  while (cinfo.next_scanline < h) {
+    unsigned y = cinfo.next_scanline;
+    for (unsigned x = 0; x < w; ++x) {
+      uint64_t n = mix(c + y * w + x) & 15;
+      row[x * 3 + 0] = (uint8_t)((c & 0xff) * x / w + n);
+      row[x * 3 + 1] = (uint8_t)((c >> 8 & 0xff) * y / h + n);
+      row[x * 3 + 2] = (uint8_t)((c >> 16 & 0xff) / 2 + ((x ^ y) & 63) + n);
+    }
+    uint8_t *rp = row.data();
+    jpeg_write_scanlines(&cinfo, &rp, 1);
+  }
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+  std::string out((const char *)buf, size);
+  free(buf);
+  return out;
+}
+
+// curl -sS -L -f -o DEST URL for img.youtube.com/vi/ID/QUALITY.jpg. Like
+// YouTube, about a third of the videos have no maxresdefault.
+int curl(const std::vector<std::string> &args) {
+  std::string dest, url;
+  for (size_t i = 0; i < args.size(); ++i) {
+    if (args[i] == "-o" && i + 1 < args.size())
+      dest = args[++i];
+    else if (args[i][0] != '-')
+      url = args[i];
+  }
+  std::string id = id_from_url(url);
+  if (id.empty() || should_fail(url))
+    return 22;
+  unsigned w = 480, h = 360;
+  if (url.find("maxresdefault") != std::string::npos) {
+    if (hash(id, 5) % 3 == 0)
+      return 22;
+    w = 1280;
+    h = 720;
+  } else if (url.find("mqdefault") != std::string::npos) {
+    w = 320;
+    h = 180;
+  }
+  std::string jpeg = make_jpeg(id, w, h);
+  FILE *f = dest.empty() ? stdout : fopen(dest.c_str(), "wb");
+  if (!f)
+    return 23;
+  fflush(f);
+  Output out(fileno(f));
+  out.write(jpeg);
+  if (f != stdout)
+    fclose(f);
+  return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string self = argv[0];
+  self = self.substr(self.rfind('/') + 1);
+  int first = 1;
+  // "ytui-fake yt-dlp ..." works without the links.
+  if (self == "ytui-fake" && argc > 1) {
+    self = argv[1];
+    first = 2;
+  }
+  std::vector<std::string> args(argv + first, argv + argc);
+  g_seed = env_u64("YTUI_FAKE_SEED", 0);
+
+  sleep_ms(env_u64("YTUI_FAKE_DELAY_MS", 0));
+  if (should_fail(self + joined(argc, argv)) && self != "mpv")
+    return 1;
+  if (self == "yt-dlp")
+    return ytdlp(args);
+  if (self == "curl")
+    return curl(args);
+  if (self == "mpv")
+    return 0;
+  fprintf(stderr, "ytui-fake: run as yt-dlp, curl or mpv\n");
+  return 2;
+}
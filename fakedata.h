@@ -0,0 +1,80 @@
+#ifndef FAKEDATA_H
+#define FAKEDATA_H
+
+// The naming scheme shared by ytui-fake (fake.cpp) and ytui-gen (gen.cpp):
+// video and channel ids, channel names and URLs, the words titles are made
+// of, and yt-dlp's restricted file names. Generated profiles only match
+// what the stand-ins serve while both use these, so neither defines its
+// own. A video id encodes its channel in its first two characters.
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+const unsigned FAKE_CHANNELS = 4096;
+
+inline const char FAKE_ID_ALPHABET[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+// 11 characters of the id alphabet; the first two hold the channel and
+// the rest come from h.
+inline std::string fake_video_id(unsigned channel, uint64_t h) {
+  std::string id(11, 'A');
+  id[0] = FAKE_ID_ALPHABET[channel / 64 % 64];
+  id[1] = FAKE_ID_ALPHABET[channel % 64];
+  for (size_t i = 2; i < 11; ++i, h >>= 6)
+    id[i] = FAKE_ID_ALPHABET[h & 63];
+  return id;
+}
+
+inline unsigned fake_channel_of_id(const std::string &id) {
+  auto digit = [](char c) -> unsigned {
+    const char *p = c ? strchr(FAKE_ID_ALPHABET, c) : nullptr;
+    return p ? (unsigned)(p - FAKE_ID_ALPHABET) : 0;
+  };
+  return id.size() >= 2 ? (digit(id[0]) * 64 + digit(id[1])) % FAKE_CHANNELS
+                        : 0;
+}
+
+inline std::string fake_channel_id(unsigned channel) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "UCytuifakechan%010u", channel);
+  return buf;
+}
+
+inline std::string fake_channel_url(unsigned channel) {
+  return "https://www.youtube.com/channel/" + fake_channel_id(channel);
+}
+
+inline std::string fake_channel_name(unsigned channel) {
+  static const char *const first[] = {"Daily", "Retro", "Quiet", "Tiny",
+                                      "Deep",  "Urban", "Café",  "Night"};
+  static const char *const second[] = {"Coding", "Jazz",    "Science",
+                                       "Travel", "Cooking", "Games",
+                                       "History", "Music"};
+  return std::string(first[channel % 8]) + " " + second[channel / 8 % 8] +
+         " " + std::to_string(channel);
+}
+
+inline const char *const FAKE_TITLE_WORDS[] = {
+    "how",      "to",      "build",  "the",    "fastest", "tiny",
+    "terminal", "video",   "player", "in",     "C++",     "lo-fi",
+    "beats",    "study",   "relax",  "review", "of",      "every",
+    "retro",    "console", "—",      "part",   "live",    "journey",
+    "through",  "Tokyo",   "at",     "night",  "naïve",   "cafés",
+    "東京",     "音楽",    "🎵",     "jazz",   "rust",    "linux",
+    "piano",    "rain",    "coffee", "vlog",   "tutorial", "explained"};
+const size_t FAKE_TITLE_WORD_COUNT =
+    sizeof(FAKE_TITLE_WORDS) / sizeof(FAKE_TITLE_WORDS[0]);
+
+// yt-dlp --restrict-filenames keeps ASCII letters, digits, '-' and '_'.
+inline std::string restricted_filename(const std::string &s) {
+  std::string out;
+  for (char c : s)
+    out += isalnum((unsigned char)c) || c == '-' ? c : '_';
+  return out;
+}
+
+#endif
@@ -0,0 +1,337 @@
+#include "filter.h"
+
+#include "config.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+
+static const uint32_t GRAM_BITS = 16;
+static const char FIELD_SEP = '\x01';
+
+// The bucket of the `width` bytes at p. Single bytes and bigrams are their
+// own bucket; trigrams are hashed into as many buckets as bigrams have.
+static uint32_t gram_bucket(int width, const char *p) {
+  uint32_t k = (unsigned char)p[0];
+  if (width == 1)
+    return k;
+  k |= (uint32_t)(unsigned char)p[1] << 8;
+  if (width == 2)
+    return k;
+  k |= (uint32_t)(unsigned char)p[2] << 16;
+  return (k * 2654435761u) >> (32 - GRAM_BITS);
+}
+
+static uint32_t gram_buckets(int width) {
+  return width == 1 ? 256 : 1u << GRAM_BITS;
+}
+
+static char lower(char c) {
+  return (char)tolower((unsigned char)c);
+}
+
+// Fills a CSR table of `buckets` posting lists from each(emit), which calls
+// emit(bucket, entry) with entries ascending per bucket and is run twice:
+// once to count, once to fill.
+template <typename Each>
+static void fill_buckets(uint32_t buckets, Each each,
+                         std::vector<uint32_t> &off,
+                         std::vector<uint32_t> &postings) {
+  std::vector<uint32_t> count(buckets + 1, 0);
+  each([&](uint32_t b, uint32_t) { ++count[b + 1]; });
+  for (uint32_t b = 0; b < buckets; ++b)
+    count[b + 1] += count[b];
+  off = count;
+  postings.resize(count[buckets]);
+  each([&](uint32_t b, uint32_t e) { postings[count[b]++] = e; });
+}
+
+static bool word_start(const char *begin, const char *p) {
+  return p == begin || !isalnum((unsigned char)p[-1]);
+}
+
+void VideoFilter::clear() {
+  text_.clear();
+  doc_off_.clear();
+  bigrams_ = trigrams_ = {};
+  for (int w = 0; w < 3; ++w)
+    heads_[w] = starts_[w] = {};
+  last_query_.clear();
+  capped_ = false;
+  matched_.clear();
+  ranked_.clear();
+}
+
+void VideoFilter::begin(size_t n) {
+  clear();
+  doc_off_.reserve(n + 1);
+  text_.reserve(n * 64);
+}
+
+void VideoFilter::add(std::string_view title, std::string_view channel) {
+  size_t at = text_.size();
+  doc_off_.push_back((uint32_t)at);
+  text_.append(title);
+  text_ += FIELD_SEP;
+  text_.append(channel);
+  text_ += '\0';
+  for (size_t i = at; i < text_.size(); ++i)
+    text_[i] = lower(text_[i]);
+}
+
+void VideoFilter::finish() {
+  doc_off_.push_back((uint32_t)text_.size());
+  index_grams(2, bigrams_);
+  index_grams(3, trigrams_);
+  for (int w = 0; w < 3; ++w) {
+    index_starts(w + 1, true, heads_[w]);
+    index_starts(w + 1, false, starts_[w]);
+  }
+}
+
+// Bigrams or trigrams of the title and of the channel, each field on its
+// own so a query is never matched across the two. `last` drops repeats of
+// a bucket within one field.
+void VideoFilter::index_grams(int width, Buckets &out) {
+  uint32_t docs = (uint32_t)doc_off_.size() - 1;
+  fill_buckets(
+      gram_buckets(width),
+      [&](auto &&emit) {
+        std::vector<uint32_t> last(gram_buckets(width), UINT32_MAX);
+        for (uint32_t d = 0; d < docs; ++d) {
+          const char *begin = text_.data() + doc_off_[d];
+          const char *end = text_.data() + doc_off_[d + 1] - 1;
+          const char *sep = (const char *)memchr(begin, FIELD_SEP, end - begin);
+          for (uint32_t field = 0; field < 2; ++field) {
+            const char *p = field ? sep + 1 : begin;
+            const char *stop = field ? end : sep;
+            uint32_t e = d << 1 | field;
+            for (; p + width <= stop; ++p) {
+              uint32_t b = gram_bucket(width, p);
+              if (last[b] != e)
+                emit(b, last[b] = e);
+            }
+          }
+        }
+      },
+      out.off, out.postings);
+}
+
+// Where title words start, keyed by their first `width` bytes: the
+// title's first word only when `heads`, every other one otherwise.
+void VideoFilter::index_starts(int width, bool heads, Buckets &out) {
+  uint32_t docs = (uint32_t)doc_off_.size() - 1;
+  uint32_t buckets = gram_buckets(width);
+  auto key = [width](const char *p) { return gram_bucket(width, p); };
+  fill_buckets(
+      buckets,
+      [&](auto &&emit) {
+        std::vector<uint32_t> last(buckets, UINT32_MAX);
+        for (uint32_t d = 0; d < docs; ++d) {
+          const char *begin = text_.data() + doc_off_[d];
+          const char *sep = (const char *)memchr(
+              begin, FIELD_SEP, doc_off_[d + 1] - doc_off_[d] - 1);
+          if (heads) {
+            if (begin < sep)
+              emit(key(begin), d << 1);
+            continue;
+          }
+          for (const char *p = begin + 1; p < sep; ++p) {
+            uint32_t k = key(p);
+            if (word_start(begin, p) && last[k] != d)
+              emit(k, (last[k] = d) << 1);
+          }
+        }
+      },
+      out.off, out.postings);
+}
+
+// rank: 3 title prefix, 2 title word start, 1 inside title, 0 channel; the
+// best of all the places q is found.
+bool VideoFilter::doc_matches(uint32_t doc, const std::string &q,
+                              int *rank) const {
+  const char *begin = text_.data() + doc_off_[doc];
+  const char *end = text_.data() + doc_off_[doc + 1] - 1;
+  const char *sep = (const char *)memchr(begin, FIELD_SEP, end - begin);
+  *rank = 0;
+  for (const char *from = begin; from < sep;) {
+    const char *hit =
+        (const char *)memmem(from, sep - from, q.data(), q.size());
+    if (!hit)
+      break;
+    if (word_start(begin, hit)) {
+      *rank = hit == begin ? 3 : 2;
+      return true;
+    }
+    *rank = 1;
+    from = hit + 1;
+  }
+  return *rank == 1 ||
+         memmem(sep + 1, end - sep - 1, q.data(), q.size()) != nullptr;
+}
+
+// True when ranks `from` and up hold FILTER_MAX_HITS matches, so any
+// further match ranked `from` or lower places after all of them.
+bool VideoFilter::ranks_full(int from) const {
+  size_t n = 0;
+  for (int r = from; r < 4; ++r)
+    n += by_rank_[r].size();
+  return n >= FILTER_MAX_HITS;
+}
+
+bool VideoFilter::collect(uint32_t doc, const std::string &q, int lo, int hi) {
+  int rank = 0;
+  if (!doc_matches(doc, q, &rank) || rank < lo || rank > hi)
+    return true;
+  if (ranks_full(rank)) {
+    capped_ = true;
+  } else {
+    matched_.push_back(doc);
+    by_rank_[rank].push_back(doc);
+  }
+  if (!ranks_full(hi))
+    return true;
+  capped_ = true;
+  return false;
+}
+
+void VideoFilter::add_gram_runs(const std::string &q, int field) {
+  if (q.size() == 2)
+    runs_.push_back(bigrams_.run(gram_bucket(2, q.data()), field));
+  for (size_t i = 0; i + 3 <= q.size(); ++i)
+    runs_.push_back(trigrams_.run(gram_bucket(3, q.data() + i), field));
+}
+
+// The first entry at or after `at` that is not below want. Gallops, since
+// successive lookups in a run mostly move a short way.
+static const uint32_t *seek(const uint32_t *at, const uint32_t *end,
+                            uint32_t want) {
+  if (at == end || *at >= want)
+    return at;
+  ptrdiff_t step = 1;
+  while (end - at > step && at[step] < want) {
+    at += step;
+    step *= 2;
+  }
+  return std::lower_bound(at + 1, end - at > step ? at + step : end, want);
+}
+
+// Walks the shortest run and looks each entry up in the others, which only
+// ever move forward, so no intersection is materialized and the walk can
+// end early.
+void VideoFilter::walk_runs(const std::string &q, int lo, int hi) {
+  if (runs_.empty())
+    return;
+  std::sort(runs_.begin(), runs_.end(), [](const Run &a, const Run &b) {
+    return a.end - a.at < b.end - b.at;
+  });
+  uint32_t last = UINT32_MAX;
+  for (const uint32_t *p = runs_[0].at; p != runs_[0].end; ++p) {
+    if (runs_[0].flag >= 0 && (int)(*p & 1) != runs_[0].flag)
+      continue;
+    uint32_t d = *p >> 1;
+    if (d == last)
+      continue;
+    last = d;
+    bool in_all = true;
+    for (size_t j = 1; j < runs_.size() && in_all; ++j) {
+      Run &run = runs_[j];
+      uint32_t want = d << 1 | (run.flag == 1);
+      run.at = seek(run.at, run.end, want);
+      if (run.at == run.end)
+        return;
+      in_all = run.flag < 0 ? *run.at >> 1 == d : *run.at == want;
+    }
+    if (in_all && !collect(d, q, lo, hi))
+      return;
+  }
+}
+
+// A single byte has no index of its own: scan the whole buffer for it,
+// jumping to the next entry after each hit.
+void VideoFilter::match_scan(const std::string &q, int lo, int hi) {
+  const char *base = text_.data();
+  const char *end = base + text_.size();
+  uint32_t d = 0;
+  for (const char *from = base; from < end;) {
+    const char *hit = (const char *)memchr(from, q[0], end - from);
+    if (!hit)
+      return;
+    uint32_t off = (uint32_t)(hit - base);
+    d = (uint32_t)(std::upper_bound(doc_off_.begin() + d, doc_off_.end(),
+                                    off) -
+                   doc_off_.begin() - 1);
+    if (!collect(d, q, lo, hi))
+      return;
+    from = base + doc_off_[++d];
+  }
+}
+
+const std::vector<uint32_t> &VideoFilter::match(const std::string &raw) {
+  std::string q;
+  q.reserve(raw.size());
+  for (char c : raw)
+    q += lower(c);
+  if (q == last_query_)
+    return ranked_;
+
+  // Anything matching the longer query matched the shorter one, as long as
+  // the shorter one's matches are complete.
+  bool narrowing = !last_query_.empty() && !capped_ &&
+                   q.find(last_query_) != std::string::npos;
+  previous_.swap(matched_);
+  matched_.clear();
+  for (auto &r : by_rank_)
+    r.clear();
+  capped_ = false;
+  // Collects ranks lo..hi from the runs set up by `runs`, unless better
+  // matches already fill the results.
+  auto ranks = [&](int lo, int hi, auto &&runs) {
+    if (ranks_full(hi)) {
+      capped_ = true;
+      return;
+    }
+    runs_.clear();
+    runs();
+    walk_runs(q, lo, hi);
+  };
+  if (q.empty() || !built()) {
+  } else if (narrowing) {
+    for (uint32_t d : previous_)
+      if (!collect(d, q, 0, 3))
+        break;
+  } else {
+    int width = (int)std::min<size_t>(q.size(), 3);
+    uint32_t k = gram_bucket(width, q.data());
+    ranks(3, 3, [&] {
+      runs_.push_back(heads_[width - 1].run(k, -1));
+      add_gram_runs(q, 0);
+    });
+    ranks(2, 2, [&] {
+      runs_.push_back(starts_[width - 1].run(k, -1));
+      add_gram_runs(q, 0);
+    });
+    if (q.size() >= 2) {
+      ranks(1, 1, [&] { add_gram_runs(q, 0); });
+      ranks(0, 0, [&] { add_gram_runs(q, 1); });
+    } else if (ranks_full(1)) {
+      capped_ = true;
+    } else {
+      match_scan(q, 0, 1);
+    }
+  }
+  // Kept in list order for the next, narrowing query.
+  if (!capped_)
+    std::sort(matched_.begin(), matched_.end());
+
+  ranked_.clear();
+  for (int r = 3; r >= 0; --r)
+    ranked_.insert(ranked_.end(), by_rank_[r].begin(), by_rank_[r].end());
+  if (ranked_.size() > FILTER_MAX_HITS) {
+    ranked_.resize(FILTER_MAX_HITS);
+    capped_ = true;
+  }
+  last_query_ = q;
+  return ranked_;
+}
@@ -0,0 +1,93 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "types.h"
+
+// Instant '/' filter over a video list. Titles and channel names are
+// lowercased into one buffer and indexed by bigram and by trigram, the
+// latter hashed into a fixed number of buckets, with each field of an
+// entry indexed apart. A hash collision only adds candidates, which are
+// all verified with a substring check anyway. Where title words start is
+// indexed too, by their first one, two and three bytes, with the title's
+// first word apart from the others. Only a one-byte query scans the buffer.
+//
+// A query collects its matches one rank at a time, best first: title
+// prefixes from the title starts, word starts from the word starts, then
+// the title and channel grams. Each walk is the intersection of the
+// posting lists involved, in list order, and ends once no further match
+// could place among the best FILTER_MAX_HITS, so a broad query costs about
+// as much as a narrow one without losing its best matches. A query that
+// extends the previous, complete one only re-checks the previous matches.
+class VideoFilter {
+public:
+  // Builds the buffer and the index. Works on a worker thread, given a list
+  // nothing else changes meanwhile.
+  template <typename List> void build(const List &list) {
+    begin(list.size());
+    for (size_t i = 0; i < list.size(); ++i)
+      add(list[i].title, list[i].channel_name);
+    finish();
+  }
+  void clear();
+  bool built() const { return !doc_off_.empty(); }
+
+  // Indices of entries matching q, best matches first and in list order
+  // within a rank, at most FILTER_MAX_HITS of them. An empty query matches
+  // nothing.
+  const std::vector<uint32_t> &match(const std::string &q);
+  // More entries matched the last query than match() returned.
+  bool capped() const { return capped_; }
+
+private:
+  // A posting list being intersected. Entries are doc << 1 | flag, and
+  // `flag` selects entries with that flag, or any when it is -1.
+  struct Run {
+    const uint32_t *at, *end;
+    int flag;
+  };
+  // Posting lists in one buffer, ascending, bucket b at off[b]..off[b + 1].
+  struct Buckets {
+    std::vector<uint32_t> off, postings;
+    Run run(uint32_t b, int flag) const {
+      return {postings.data() + off[b], postings.data() + off[b + 1], flag};
+    }
+  };
+
+  void begin(size_t n);
+  void add(std::string_view title, std::string_view channel);
+  void finish();
+  void index_grams(int width, Buckets &out);
+  void index_starts(int width, bool heads, Buckets &out);
+  bool doc_matches(uint32_t doc, const std::string &q, int *rank) const;
+  // Keeps doc if it contains q at a rank in [lo, hi] that can still place
+  // among the best; false once nothing more in that range can.
+  bool collect(uint32_t doc, const std::string &q, int lo, int hi);
+  bool ranks_full(int from) const;
+  void add_gram_runs(const std::string &q, int field);
+  void walk_runs(const std::string &q, int lo, int hi);
+  void match_scan(const std::string &q, int lo, int hi);
+
+  std::string text_;              // "title\x01channel\0" per entry
+  std::vector<uint32_t> doc_off_; // start of each entry in text_
+  Buckets bigrams_, trigrams_; // doc << 1 | found in the channel
+  // Title starts and other word starts by their first 1, 2 and 3 bytes;
+  // entries are doc << 1.
+  std::array<Buckets, 3> heads_, starts_;
+
+  std::string last_query_;
+  bool capped_ = false;
+  std::vector<uint32_t> matched_; // matches for last_query_, list order
+  std::vector<uint32_t> ranked_;
+  // Scratch kept between queries so typing does not allocate.
+  std::vector<uint32_t> previous_;
+  std::array<std::vector<uint32_t>, 4> by_rank_;
+  std::vector<Run> runs_;
+};
+
+#endif
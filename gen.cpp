@@ -0,0 +1,203 @@
+// Builds a large, realistic profile for scale testing: watch history,
+// subscriptions, search history, and a download directory with its
+// catalog and channel map, all written through ytui's own save paths so
+// the formats match what a real profile holds.
+//
+//   ytui-gen [--scale K] [--history N] [--subs N] [--searches N]
+//            [--videos N] [--seed N] DIR
+//
+// DIR becomes a HOME for ytui, ytui-replay --home or ytui-bench. --scale
+// multiplies the base profile of 5000 history entries, 100 subscriptions,
+// 1000 searches and 250 downloaded videos (default 4, roughly the
+// profiles we see in practice); the other options override one count.
+// Ids, channels and titles follow the scheme in fakedata.h that ytui-fake
+// serves, so refreshes against the stand-ins find the subscribed channels.
+// Downloaded files are sparse.
+
+#include "catalog.h"
+#include "chanmap.h"
+#include "config.h"
+#include "fakedata.h"
+#include "globals.h"
+#include "persist.h"
+#include "utils.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+std::string words(std::mt19937_64 &rng, size_t lo, size_t hi) {
+  size_t count = lo + rng() % (hi - lo + 1);
+  std::string out;
+  for (size_t i = 0; i < count; ++i) {
+    if (!out.empty())
+      out += ' ';
+    out += FAKE_TITLE_WORDS[rng() % FAKE_TITLE_WORD_COUNT];
+  }
+  return out;
+}
+
+Video make_video(unsigned channel, std::mt19937_64 &rng) {
+  Video v;
+  v.id = fake_video_id(channel, rng());
+  std::string title = words(rng, 3, 10);
+  title[0] = (char)toupper((unsigned char)title[0]);
+  v.title = title;
+  v.channel_id = fake_channel_id(channel);
+  v.channel_url = fake_channel_url(channel);
+  v.channel_name = fake_channel_name(channel);
+  v.duration = (uint32_t)(30 + rng() % 5400);
+  v.upload_date = (uint32_t)(20100101 + rng() % 16 * 10000 + rng() % 12 * 100 +
+                             rng() % 28);
+  v.view_count = rng() % 50000000;
+  return v;
+}
+
+struct Counts {
+  size_t history = 5000, subs = 100, searches = 1000, videos = 250;
+};
+
+int usage() {
+  fprintf(stderr, "usage: ytui-gen [--scale K] [--history N] [--subs N] "
+                  "[--searches N] [--videos N] [--seed N] DIR\n");
+  return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Counts n;
+  size_t scale = 4;
+  long history_n = -1, subs_n = -1, searches_n = -1, videos_n = -1;
+  uint64_t seed = 1;
+  std::string dir;
+  for (int i = 1; i < argc; ++i) {
+    std::string a = argv[i];
+    bool more = i + 1 < argc;
+    if (a == "--scale" && more)
+      scale = strtoul(argv[++i], nullptr, 10);
+    else if (a == "--history" && more)
+      history_n = atol(argv[++i]);
+    else if (a == "--subs" && more)
+      subs_n = atol(argv[++i]);
+    else if (a == "--searches" && more)
+      searches_n = atol(argv[++i]);
+    else if (a == "--videos" && more)
+      videos_n = atol(argv[++i]);
+    else if (a == "--seed" && more)
+      seed = strtoull(argv[++i], nullptr, 10);
+    else if (dir.empty() && a[0] != '-')
+      dir = a;
+    else
+      return usage();
+  }
+  if (dir.empty())
+    return usage();
+  n.history = history_n >= 0 ? (size_t)history_n : n.history * scale;
+  n.subs = subs_n >= 0 ? (size_t)subs_n : n.subs * scale;
+  n.searches = searches_n >= 0 ? (size_t)searches_n : n.searches * scale;
+  n.videos = videos_n >= 0 ? (size_t)videos_n : n.videos * scale;
+
+  // The profile paths in config.h come from HOME when the process starts.
+  if (!getenv("YTUI_GEN_HOME")) {
+    mkdir(dir.c_str(), 0755);
+    mkdir((dir + "/.cache").c_str(), 0755);
+    mkdir((dir + "/.config").c_str(), 0755);
+    char *abs = realpath(dir.c_str(), nullptr);
+    if (!abs) {
+      perror(dir.c_str());
+      return 1;
+    }
+    setenv("HOME", abs, 1);
+    setenv("YTUI_GEN_HOME", abs, 1);
+    free(abs);
+    execv("/proc/self/exe", argv);
+    perror("execv");
+    return 1;
+  }
+  mkdirs();
+  ensure_video_cache();
+  std::mt19937_64 rng(seed);
+
+  // Subscribed channels are the ones most of the history comes from.
+  std::vector<unsigned> channels;
+  for (size_t i = 0; i < n.subs; ++i) {
+    unsigned ch = (unsigned)(rng() % FAKE_CHANNELS);
+    channels.push_back(ch);
+    subs.push_back({fake_channel_name(ch), fake_channel_url(ch)});
+  }
+  save_subs();
+
+  auto pick_channel = [&] {
+    if (!channels.empty() && rng() % 10 < 7)
+      return channels[rng() % channels.size()];
+    return (unsigned)(rng() % FAKE_CHANNELS);
+  };
+
+  // Played oldest first, so the snapshot lists them newest first.
+  load_history();
+  std::vector<Video> watched;
+  watched.reserve(n.history);
+  for (size_t i = 0; i < n.history; ++i)
+    watched.push_back(make_video(pick_channel(), rng));
+  for (const Video &v : watched)
+    history.record(v);
+  history.compact();
+  channel_map_note(watched);
+
+  // Searches repeat, as they do in practice: a small set of favourites
+  // plus a long tail.
+  std::vector<std::string> favourites;
+  for (size_t i = 0; i < 20; ++i)
+    favourites.push_back(words(rng, 1, 3));
+  for (size_t i = 0; i < n.searches; ++i)
+    search_completer.use(rng() % 3 == 0 ? favourites[rng() % favourites.size()]
+                                        : words(rng, 2, 5));
+  save_search_hist();
+
+  // Most downloads come from the history and were queued through ytui;
+  // a tenth are files the catalog adopts by name.
+  catalog_load();
+  time_t now = time(nullptr);
+  std::unordered_set<VideoId> downloaded;
+  while (downloaded.size() < n.videos) {
+    Video v = !watched.empty() && rng() % 4 != 0
+                  ? watched[rng() % watched.size()]
+                  : make_video(pick_channel(), rng);
+    if (!downloaded.insert(v.id).second)
+      continue;
+    std::string path = VIDEO_CACHE + "/" +
+                       restricted_filename(v.title.str()) + v.id.str() + ".mkv";
+    if (rng() % 10 != 0)
+      catalog_expect(v);
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, (off_t)((50 + rng() % 750) << 20)) != 0) {
+      perror(path.c_str());
+      return 1;
+    }
+    close(fd);
+    struct timespec when[2];
+    when[0] = when[1] = {now - (time_t)(rng() % (365 * 86400)), 0};
+    utimensat(AT_FDCWD, path.c_str(), when, 0);
+  }
+  // The catalog does not trust a directory modified in the last moments.
+  struct timespec past[2] = {{now - 60, 0}, {now - 60, 0}};
+  utimensat(AT_FDCWD, VIDEO_CACHE.c_str(), past, 0);
+  catalog_sync();
+
+  persist_flush();
+  printf("%s: %zu history, %zu subscriptions, %zu searches, %zu videos\n",
+         getenv("YTUI_GEN_HOME"), history.size(), subs.size(),
+         search_completer.entries().size(), catalog_videos().size());
+  return 0;
+}
@@ -2,8 +2,10 @@
 
 // Global state definitions
 std::vector<std::string> search_hist;
-std::vector<Video> res;
-std::vector<Video> history;
+Completer search_completer;
+VideoList res;
+std::string res_source;
+History history;
 std::vector<Download> downloads;
 std::vector<Channel> subs;
 std::string query;
@@ -12,11 +14,20 @@ std::string status_msg;
 time_t status_time = 0;
 Focus focus = HOME;
 bool insert_mode = false;
+std::string filter_query;
+bool filter_editing = false;
+Focus filter_focus = HOME;
+SortOrder list_sort = SORT_LISTED;
+Focus sort_focus = HOME;
 size_t query_pos = 0;
 int subs_channel_idx = -1;
-std::vector<std::vector<Video>> subs_cache;
+std::vector<VideoList> subs_cache;
+std::unordered_map<std::string, ChannelState> channel_states;
+VideoList feed_videos;
+size_t subs_refresh_done = 0;
+size_t subs_refresh_total = 0;
 int search_hist_idx = -1;
-std::vector<Video> channel_videos;
+VideoList channel_videos;
 std::string channel_url;
 bool channel_return_active = false;
 Focus channel_return_focus = HOME;
@@ -26,6 +37,8 @@ size_t results_scroll = 0;
 size_t downloads_scroll = 0;
 size_t channel_scroll = 0;
 size_t subs_scroll = 0;
+size_t feed_scroll = 0;
 bool thumbnail_shown = false;
+bool perf_overlay = false;
 time_t thumbnail_resume_time = 0;
 
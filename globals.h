@@ -4,19 +4,28 @@
 #include <cstddef>
 #include <ctime>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "complete.h"
+#include "history.h"
 #include "types.h"
 
-extern std::vector<std::string> search_hist;
-extern std::vector<Video> res;
-extern std::vector<Video> history;
+extern std::vector<std::string> search_hist; // recent searches, newest first
+extern Completer search_completer;           // full search history
+extern VideoList res;
+extern std::string res_source; // query that produced res
+extern History history;
 extern std::vector<Download> downloads;
 extern std::vector<Channel> subs;
-extern std::vector<Video> channel_videos;
+extern VideoList channel_videos;
 extern std::string channel_url;
 extern int subs_channel_idx;
-extern std::vector<std::vector<Video>> subs_cache;
+extern std::vector<VideoList> subs_cache;
+extern std::unordered_map<std::string, ChannelState> channel_states; // by cache key
+extern VideoList feed_videos; // merged new uploads across subs
+extern size_t subs_refresh_done;       // progress of a running refresh-all
+extern size_t subs_refresh_total;      // 0 when no refresh-all is running
 extern std::string query;
 extern size_t sel;
 extern size_t query_pos;
@@ -24,6 +33,11 @@ extern std::string status_msg;
 extern time_t status_time;
 extern Focus focus;
 extern bool insert_mode;
+extern std::string filter_query; // '/' filter text, applies to filter_focus
+extern bool filter_editing;
+extern Focus filter_focus;
+extern SortOrder list_sort; // applies to sort_focus
+extern Focus sort_focus;
 extern int search_hist_idx;
 extern bool channel_return_active;
 extern Focus channel_return_focus;
@@ -33,7 +47,9 @@ extern size_t results_scroll;
 extern size_t downloads_scroll;
 extern size_t channel_scroll;
 extern size_t subs_scroll;
+extern size_t feed_scroll;
 extern bool thumbnail_shown;       // true while a thumbnail is active
+extern bool perf_overlay;          // frame statistics shown over the view
 extern time_t thumbnail_resume_time;
 
 #endif
@@ -0,0 +1,211 @@
+#include "history.h"
+
+#include "config.h"
+#include "persist.h"
+#include "utils.h"
+
+#include <atomic>
+#include <fstream>
+
+static std::string history_line(const Video &v) {
+  return v.id.str() + "|||" + esc(v.title) + '\n';
+}
+
+static bool parse_history_line(const std::string &line, Video &v) {
+  size_t sep = line.find("|||");
+  if (sep == std::string::npos)
+    return false;
+  v.id = line.substr(0, sep);
+  v.title = unesc(line.substr(sep + 3));
+  return true;
+}
+
+const Video &History::operator[](size_t i) const {
+  size_t pos = 0;
+  uint32_t n = head_;
+  if (size_ - 1 - i < i) {
+    pos = size_ - 1;
+    n = tail_;
+  }
+  if (cur_node_ != NIL) {
+    size_t d = cur_pos_ > i ? cur_pos_ - i : i - cur_pos_;
+    size_t best = pos > i ? pos - i : i - pos;
+    if (d < best) {
+      pos = cur_pos_;
+      n = cur_node_;
+    }
+  }
+  while (pos < i) {
+    n = slab_[n].next;
+    ++pos;
+  }
+  while (pos > i) {
+    n = slab_[n].prev;
+    --pos;
+  }
+  cur_pos_ = i;
+  cur_node_ = n;
+  return slab_[n].v;
+}
+
+const Video *History::find(const std::string &id) const {
+  auto it = index_.find(id);
+  return it == index_.end() ? nullptr : &slab_[it->second].v;
+}
+
+void History::unlink_node(uint32_t n) {
+  Node &node = slab_[n];
+  if (node.prev != NIL)
+    slab_[node.prev].next = node.next;
+  else
+    head_ = node.next;
+  if (node.next != NIL)
+    slab_[node.next].prev = node.prev;
+  else
+    tail_ = node.prev;
+  node.prev = node.next = NIL;
+}
+
+void History::link_front(uint32_t n) {
+  slab_[n].prev = NIL;
+  slab_[n].next = head_;
+  if (head_ != NIL)
+    slab_[head_].prev = n;
+  head_ = n;
+  if (tail_ == NIL)
+    tail_ = n;
+}
+
+void History::link_back(uint32_t n) {
+  slab_[n].next = NIL;
+  slab_[n].prev = tail_;
+  if (tail_ != NIL)
+    slab_[tail_].next = n;
+  tail_ = n;
+  if (head_ == NIL)
+    head_ = n;
+}
+
+void History::changed() {
+  static std::atomic<uint64_t> next{0};
+  version_ = ++next;
+}
+
+uint32_t History::alloc(Video &&v) {
+  uint32_t n = (uint32_t)slab_.size();
+  index_.emplace(v.id, n);
+  slab_.push_back({std::move(v), NIL, NIL});
+  ++size_;
+  changed();
+  return n;
+}
+
+void History::touch(const Video &v) {
+  cur_node_ = NIL;
+  auto it = index_.find(v.id);
+  if (it == index_.end()) {
+    link_front(alloc(Video(v)));
+    return;
+  }
+  uint32_t n = it->second;
+  if (n == head_)
+    return;
+  unlink_node(n);
+  link_front(n);
+  changed();
+}
+
+void History::append(Video v) {
+  if (index_.count(v.id))
+    return;
+  cur_node_ = NIL;
+  link_back(alloc(std::move(v)));
+}
+
+void History::clear() {
+  slab_.clear();
+  index_.clear();
+  head_ = tail_ = cur_node_ = NIL;
+  size_ = 0;
+  changed();
+}
+
+std::vector<Video> History::snapshot() const {
+  std::vector<Video> out;
+  out.reserve(size_);
+  for (uint32_t n = head_; n != NIL; n = slab_[n].next)
+    out.push_back(slab_[n].v);
+  return out;
+}
+
+VideoList History::shared() const {
+  if (shared_version_ != version_) {
+    shared_ = snapshot();
+    shared_version_ = version_;
+  }
+  return shared_;
+}
+
+void History::replay(const std::string &path) {
+  std::ifstream f(path);
+  std::string line;
+  Video v;
+  while (std::getline(f, line)) {
+    if (!parse_history_line(line, v))
+      continue;
+    touch(v);
+    ++journal_entries_;
+  }
+}
+
+void History::load(const std::string &snapshot_path,
+                   const std::string &journal_path) {
+  snapshot_path_ = snapshot_path;
+  journal_path_ = journal_path;
+  clear();
+  journal_entries_ = 0;
+
+  std::ifstream f(snapshot_path, std::ios::ate);
+  if (f) {
+    // Lines average well over 32 bytes; over-reserving beats rehashing.
+    size_t estimate = (size_t)f.tellg() / 32;
+    slab_.reserve(estimate);
+    index_.reserve(estimate);
+    f.seekg(0);
+  }
+  std::string line;
+  Video v;
+  while (std::getline(f, line))
+    if (parse_history_line(line, v))
+      append(std::move(v));
+  // A crash between writing a snapshot and removing the journal leaves
+  // plays the snapshot already holds. Replay is order-preserving, so
+  // applying them again yields the same order.
+  replay(journal_path);
+}
+
+void History::record(const Video &v) {
+  touch(v);
+  if (journal_path_.empty())
+    return;
+  persist_append(journal_path_, history_line(v));
+  if (++journal_entries_ >= HISTORY_COMPACT_EVERY)
+    compact();
+}
+
+void History::compact() {
+  if (snapshot_path_.empty() || journal_entries_ == 0)
+    return;
+  journal_entries_ = 0;
+  // The persistence queue is FIFO, so every journal append queued so far
+  // lands before the snapshot that covers it replaces the journal.
+  persist_replace(
+      snapshot_path_,
+      [entries = snapshot()]() {
+        std::string out;
+        for (const auto &v : entries)
+          out += history_line(v);
+        return out;
+      },
+      journal_path_);
+}
@@ -0,0 +1,72 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "types.h"
+
+// Play history in most-recently-used order. Entries live in a slab linked
+// by index, with an id -> slot map, so moving an entry to the front is
+// O(1). Indexing walks from the nearest of head, tail or the last index
+// visited, which keeps the sequential access done by rendering O(1).
+//
+// On disk the history is a snapshot file (newest first) plus an
+// append-only journal of plays. The journal is replayed on load and folded
+// into a new snapshot every HISTORY_COMPACT_EVERY plays. All writes go
+// through the write-behind persistence thread.
+class History {
+public:
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const Video &operator[](size_t i) const;
+  const Video *find(const std::string &id) const;
+
+  void touch(const Video &v);  // insert or move to the front
+  void append(Video v); // insert as oldest; ignored when present
+  void clear();
+  std::vector<Video> snapshot() const;
+  // snapshot() as a VideoList, copied once per version and shared after.
+  VideoList shared() const;
+  // Changes whenever the entries or their order do. Values are never
+  // reused, even by another History, so a cache keyed on it cannot
+  // mistake a replaced history for the one it saw.
+  uint64_t version() const { return version_; }
+
+  void load(const std::string &snapshot_path, const std::string &journal_path);
+  // touch() plus a journal append; may queue a compaction.
+  void record(const Video &v);
+  // Queue a new snapshot that replaces the journal.
+  void compact();
+
+private:
+  static const uint32_t NIL = UINT32_MAX;
+  struct Node {
+    Video v;
+    uint32_t prev, next;
+  };
+
+  void unlink_node(uint32_t n);
+  void link_front(uint32_t n);
+  void link_back(uint32_t n);
+  uint32_t alloc(Video &&v);
+  void replay(const std::string &path);
+  void changed();
+
+  std::vector<Node> slab_;
+  std::unordered_map<VideoId, uint32_t> index_;
+  uint32_t head_ = NIL, tail_ = NIL;
+  size_t size_ = 0;
+  uint64_t version_ = 0;
+  mutable size_t cur_pos_ = 0;
+  mutable uint32_t cur_node_ = NIL;
+  mutable VideoList shared_;
+  mutable uint64_t shared_version_ = 0;
+
+  std::string snapshot_path_, journal_path_;
+  size_t journal_entries_ = 0;
+};
+
+#endif
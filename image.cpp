@@ -0,0 +1,284 @@
+#include "image.h"
+
+#include "trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <jpeglib.h>
+
+static void jpeg_noop_error(j_common_ptr) {}
+static void jpeg_noop_msg(j_common_ptr, int) {}
+
+bool jpeg_to_rgba(const std::string &path, std::vector<uint8_t> &out,
+                  unsigned &w, unsigned &h) {
+  TraceSpan span("jpeg_to_rgba");
+  FILE *f = fopen(path.c_str(), "rb");
+  if (!f)
+    return false;
+  struct jpeg_decompress_struct cinfo = {};
+  struct jpeg_error_mgr jerr = {};
+  cinfo.err = jpeg_std_error(&jerr);
+  jerr.error_exit = jpeg_noop_error;
+  jerr.emit_message = jpeg_noop_msg;
+  jerr.output_message = jpeg_noop_error;
+  jpeg_create_decompress(&cinfo);
+  jpeg_stdio_src(&cinfo, f);
+  if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK) {
+    jpeg_destroy_decompress(&cinfo);
+    fclose(f);
+    return false;
+  }
+  cinfo.out_color_space = JCS_EXT_RGBA;
+  jpeg_start_decompress(&cinfo);
+  w = cinfo.output_width;
+  h = cinfo.output_height;
+  int comp = cinfo.output_components;
+  std::vector<uint8_t> row_buf(w * comp);
+  out.resize(w * h * 4);
+  uint8_t *dst = out.data();
+  while (cinfo.output_scanline < h) {
+    uint8_t *rp = row_buf.data();
+    jpeg_read_scanlines(&cinfo, &rp, 1);
+    if (comp == 4) {
+      memcpy(dst, row_buf.data(), w * 4);
+    } else {
+      for (unsigned x = 0; x < w; ++x) {
+        dst[x * 4 + 0] = row_buf[x * 3 + 0];
+        dst[x * 4 + 1] = row_buf[x * 3 + 1];
+        dst[x * 4 + 2] = row_buf[x * 3 + 2];
+        dst[x * 4 + 3] = 255;
+      }
+    }
+    dst += w * 4;
+  }
+  jpeg_finish_decompress(&cinfo);
+  jpeg_destroy_decompress(&cinfo);
+  fclose(f);
+  return true;
+}
+
+void rgba_scale(const uint8_t *src, unsigned sw, unsigned sh,
+                std::vector<uint8_t> &dst, unsigned dw, unsigned dh) {
+  TraceSpan span("rgba_scale");
+  dst.resize((size_t)dw * dh * 4);
+  float sx = (float)sw / dw, sy = (float)sh / dh;
+  for (unsigned y = 0; y < dh; ++y) {
+    float fy = (y + 0.5f) * sy - 0.5f;
+    int y0 = std::max(0, (int)fy), y1 = std::min((int)sh - 1, y0 + 1);
+    float vy = fy - y0;
+    for (unsigned x = 0; x < dw; ++x) {
+      float fx = (x + 0.5f) * sx - 0.5f;
+      int x0 = std::max(0, (int)fx), x1 = std::min((int)sw - 1, x0 + 1);
+      float vx = fx - x0;
+      const uint8_t *p00 = src + ((size_t)y0 * sw + x0) * 4,
+                    *p10 = src + ((size_t)y0 * sw + x1) * 4;
+      const uint8_t *p01 = src + ((size_t)y1 * sw + x0) * 4,
+                    *p11 = src + ((size_t)y1 * sw + x1) * 4;
+      uint8_t *d = dst.data() + ((size_t)y * dw + x) * 4;
+      for (int c = 0; c < 4; ++c)
+        d[c] = (uint8_t)(p00[c] * (1 - vx) * (1 - vy) + p10[c] * vx * (1 - vy) +
+                         p01[c] * (1 - vx) * vy + p11[c] * vx * vy + 0.5f);
+    }
+  }
+}
+
+void rgba_downsample(const uint8_t *src, unsigned sw, unsigned sh,
+                     std::vector<uint8_t> &dst, unsigned dw, unsigned dh) {
+  if (!dw || !dh || dw > sw || dh > sh) {
+    rgba_scale(src, sw, sh, dst, dw, dh);
+    return;
+  }
+  TraceSpan span("rgba_downsample");
+  dst.resize((size_t)dw * dh * 4);
+  // Sums of the source rows under one destination row, added a whole row
+  // at a time in a flat loop the compiler vectorizes; the columns are then
+  // summed from it.
+  const size_t stride = (size_t)sw * 4;
+  std::vector<uint32_t> acc(stride);
+  for (unsigned y = 0; y < dh; ++y) {
+    unsigned y0 = (unsigned)((uint64_t)y * sh / dh);
+    unsigned y1 = (unsigned)((uint64_t)(y + 1) * sh / dh);
+    std::fill(acc.begin(), acc.end(), 0);
+    for (unsigned sy = y0; sy < y1; ++sy) {
+      const uint8_t *row = src + sy * stride;
+      uint32_t *a = acc.data();
+      for (size_t i = 0; i < stride; ++i)
+        a[i] += row[i];
+    }
+    uint8_t *d = dst.data() + (size_t)y * dw * 4;
+    for (unsigned x = 0; x < dw; ++x) {
+      unsigned x0 = (unsigned)((uint64_t)x * sw / dw);
+      unsigned x1 = (unsigned)((uint64_t)(x + 1) * sw / dw);
+      uint32_t sum[4] = {0, 0, 0, 0};
+      for (unsigned sx = x0; sx < x1; ++sx)
+        for (int c = 0; c < 4; ++c)
+          sum[c] += acc[sx * 4 + c];
+      uint32_t n = (x1 - x0) * (y1 - y0);
+      for (int c = 0; c < 4; ++c)
+        d[x * 4 + c] = (uint8_t)((sum[c] + n / 2) / n);
+    }
+  }
+}
+
+void fit_dims(unsigned sw, unsigned sh, unsigned mw, unsigned mh,
+              unsigned &ow, unsigned &oh) {
+  if (!sw || !sh) {
+    ow = mw;
+    oh = mh;
+    return;
+  }
+  float s = std::min((float)mw / sw, (float)mh / sh);
+  ow = std::max(1u, (unsigned)(sw * s));
+  oh = std::max(1u, (unsigned)(sh * s));
+}
+
+static const char B64[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+std::string b64_encode(const uint8_t *data, size_t len) {
+  std::string out;
+  out.reserve(((len + 2) / 3) * 4);
+  for (size_t i = 0; i < len; i += 3) {
+    unsigned b = (unsigned)data[i] << 16;
+    if (i + 1 < len)
+      b |= (unsigned)data[i + 1] << 8;
+    if (i + 2 < len)
+      b |= (unsigned)data[i + 2];
+    out += B64[(b >> 18) & 63];
+    out += B64[(b >> 12) & 63];
+    out += (i + 1 < len) ? B64[(b >> 6) & 63] : '=';
+    out += (i + 2 < len) ? B64[b & 63] : '=';
+  }
+  return out;
+}
+
+static const unsigned KITTY_ID = 1;
+static const unsigned KITTY_PID = 1;
+static const size_t KITTY_CHUNK = 4096;
+
+std::string kitty_upload_cmd(const std::vector<uint8_t> &rgba, unsigned w,
+                             unsigned h) {
+  std::string enc = b64_encode(rgba.data(), rgba.size());
+  std::string out;
+  out += "\033_Ga=d,d=I,i=" + std::to_string(KITTY_ID) + ",q=2;\033\\";
+  size_t sent = 0;
+  bool first = true;
+  while (sent < enc.size()) {
+    size_t n = std::min(KITTY_CHUNK, enc.size() - sent);
+    int more = (sent + n < enc.size()) ? 1 : 0;
+    if (first) {
+      out += "\033_Ga=t,f=32,i=" + std::to_string(KITTY_ID) +
+             ",s=" + std::to_string(w) + ",v=" + std::to_string(h) +
+             ",q=2,m=" + std::to_string(more) + ";" + enc.substr(sent, n) +
+             "\033\\";
+      first = false;
+    } else {
+      out += "\033_Gm=" + std::to_string(more) + ";" + enc.substr(sent, n) +
+             "\033\\";
+    }
+    sent += n;
+  }
+  return out;
+}
+
+std::string kitty_place_cmd(int col, int row, unsigned w, unsigned h) {
+  std::string out;
+  out += "\0337";
+  out +=
+      "\033[" + std::to_string(row + 1) + ";" + std::to_string(col + 1) + "H";
+  out += "\033_Ga=p,i=" + std::to_string(KITTY_ID) +
+         ",p=" + std::to_string(KITTY_PID) + ",s=" + std::to_string(w) +
+         ",v=" + std::to_string(h) + ",q=2;\033\\";
+  out += "\0338";
+  return out;
+}
+
+std::string kitty_delete_cmd() {
+  return "\033_Ga=d,d=I,i=" + std::to_string(KITTY_ID) + ",q=2;\033\\";
+}
+
+std::vector<BlockCell> rgba_to_blocks(const std::vector<uint8_t> &rgba,
+                                      unsigned w, unsigned h) {
+  auto pixel = [&](unsigned x, unsigned y) {
+    const uint8_t *p = rgba.data() + ((size_t)y * w + x) * 4;
+    return (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2];
+  };
+  std::vector<BlockCell> cells;
+  cells.reserve((size_t)w * (h / 2));
+  for (unsigned y = 0; y + 1 < h; y += 2)
+    for (unsigned x = 0; x < w; ++x)
+      cells.push_back({pixel(x, y), pixel(x, y + 1)});
+  return cells;
+}
+
+// Nearest colour of the xterm palette: the 6x6x6 cube or the grey ramp.
+static int xterm_color(uint32_t rgb) {
+  static const int LEVELS[6] = {0, 95, 135, 175, 215, 255};
+  int v[3] = {(int)(rgb >> 16 & 255), (int)(rgb >> 8 & 255), (int)(rgb & 255)};
+  int idx[3], cube_dist = 0;
+  for (int c = 0; c < 3; ++c) {
+    idx[c] = v[c] < 48 ? 0 : v[c] < 115 ? 1 : (v[c] - 35) / 40;
+    int d = v[c] - LEVELS[idx[c]];
+    cube_dist += d * d;
+  }
+  int grey = std::min(23, std::max(0, ((v[0] + v[1] + v[2]) / 3 - 3) / 10));
+  int grey_dist = 0;
+  for (int c = 0; c < 3; ++c) {
+    int d = v[c] - (8 + 10 * grey);
+    grey_dist += d * d;
+  }
+  if (grey_dist < cube_dist)
+    return 232 + grey;
+  return 16 + 36 * idx[0] + 6 * idx[1] + idx[2];
+}
+
+static void append_color(std::string &out, int layer, uint32_t rgb,
+                         bool truecolor) {
+  char buf[24];
+  if (truecolor)
+    snprintf(buf, sizeof(buf), "%d;2;%u;%u;%u", layer, rgb >> 16 & 255,
+             rgb >> 8 & 255, rgb & 255);
+  else
+    snprintf(buf, sizeof(buf), "%d;5;%d", layer, xterm_color(rgb));
+  out += buf;
+}
+
+std::string blocks_draw_cmd(const std::vector<BlockCell> &cells,
+                            const std::vector<BlockCell> &shown, unsigned w,
+                            int col, int row, bool truecolor) {
+  if (!w)
+    return {};
+  bool all = shown.size() != cells.size();
+  std::string out;
+  int at_row = -1, at_col = -1;
+  BlockCell sgr = BLOCK_UNKNOWN;
+  char buf[32];
+  for (size_t i = 0; i < cells.size(); ++i) {
+    const BlockCell &b = cells[i];
+    if (!all && b == shown[i])
+      continue;
+    int r = row + (int)(i / w), c = col + (int)(i % w);
+    if (r != at_row || c != at_col) {
+      snprintf(buf, sizeof(buf), "\033[%d;%dH", r + 1, c + 1);
+      out += buf;
+    }
+    if (b != sgr) {
+      out += "\033[";
+      if (b.top != sgr.top)
+        append_color(out, 38, b.top, truecolor);
+      if (b.top != sgr.top && b.bottom != sgr.bottom)
+        out += ';';
+      if (b.bottom != sgr.bottom)
+        append_color(out, 48, b.bottom, truecolor);
+      out += 'm';
+      sgr = b;
+    }
+    out += "\u2580"; // ▀
+    at_row = r;
+    at_col = c + 1;
+  }
+  if (out.empty())
+    return out;
+  return "\0337" + out + "\0338";
+}
@@ -0,0 +1,63 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Thumbnail pixel work and the terminal commands that carry it: the kitty
+// graphics protocol, or half-block character cells for terminals without
+// it. Nothing here touches the terminal; utils.cpp writes the commands.
+
+// Decode a JPEG file to 8-bit RGBA. False when it cannot be read.
+bool jpeg_to_rgba(const std::string &path, std::vector<uint8_t> &out,
+                  unsigned &w, unsigned &h);
+
+// Bilinear resize of an RGBA image to dw x dh.
+void rgba_scale(const uint8_t *src, unsigned sw, unsigned sh,
+                std::vector<uint8_t> &dst, unsigned dw, unsigned dh);
+
+// Box-filtered shrink of an RGBA image to dw x dh: every destination
+// pixel is the mean of the source pixels it covers, so small targets do
+// not alias the way bilinear sampling does. Enlarging uses rgba_scale().
+void rgba_downsample(const uint8_t *src, unsigned sw, unsigned sh,
+                     std::vector<uint8_t> &dst, unsigned dw, unsigned dh);
+
+// Largest size with the aspect of sw x sh that fits in mw x mh.
+void fit_dims(unsigned sw, unsigned sh, unsigned mw, unsigned mh,
+              unsigned &ow, unsigned &oh);
+
+std::string b64_encode(const uint8_t *data, size_t len);
+
+// Commands that replace the thumbnail image with rgba, show it at the
+// cursor position (col, row) and delete it again.
+std::string kitty_upload_cmd(const std::vector<uint8_t> &rgba, unsigned w,
+                             unsigned h);
+std::string kitty_place_cmd(int col, int row, unsigned w, unsigned h);
+std::string kitty_delete_cmd();
+
+// One character cell of a half-block thumbnail: "▀" in the colour of the
+// upper pixel on the colour of the lower one, both 0xRRGGBB.
+struct BlockCell {
+  uint32_t top = 0, bottom = 0;
+  bool operator==(const BlockCell &o) const {
+    return top == o.top && bottom == o.bottom;
+  }
+  bool operator!=(const BlockCell &o) const { return !(*this == o); }
+};
+// Matches no real cell; for cells whose contents on screen are unknown.
+inline const BlockCell BLOCK_UNKNOWN = {0xffffffff, 0xffffffff};
+
+// The cells of a w x h RGBA image, w per row and h / 2 rows.
+std::vector<BlockCell> rgba_to_blocks(const std::vector<uint8_t> &rgba,
+                                      unsigned w, unsigned h);
+// Draws the cells of a grid w cells wide at (col, row), skipping the ones
+// equal to the same cell of shown (all are drawn when shown has a
+// different size), then puts the cursor and attributes back. Colours are
+// 24-bit, or the nearest of the 256 xterm ones. Empty when nothing differs.
+std::string blocks_draw_cmd(const std::vector<BlockCell> &cells,
+                            const std::vector<BlockCell> &shown, unsigned w,
+                            int col, int row, bool truecolor);
+
+#endif
@@ -0,0 +1,88 @@
+#include "intern.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+const size_t BLOCK_SIZE = 64 * 1024;
+
+// Length-prefixed records, as Str expects: four zero bytes, then "\0".
+const char EMPTY_RECORD[sizeof(uint32_t) + 1] = {};
+
+struct Arena {
+  std::mutex mu;
+  std::vector<char *> blocks;
+  char *cur = nullptr;
+  size_t left = 0;
+  size_t bytes = 0;
+  std::unordered_set<std::string_view> values;
+};
+
+// Leaked on purpose: Strs may be used by static destructors and detached
+// threads right up to exit.
+Arena &arena() {
+  static Arena *a = new Arena;
+  return *a;
+}
+
+} // namespace
+
+const char *const Str::EMPTY = EMPTY_RECORD + sizeof(uint32_t);
+
+const char *Str::intern(std::string_view s) {
+  if (s.empty())
+    return EMPTY;
+  Arena &a = arena();
+  std::lock_guard<std::mutex> lock(a.mu);
+  auto it = a.values.find(s);
+  if (it != a.values.end())
+    return it->data();
+
+  size_t need = sizeof(uint32_t) + s.size() + 1;
+  if (need > a.left) {
+    size_t size = std::max(BLOCK_SIZE, need);
+    a.blocks.push_back(new char[size]);
+    a.cur = a.blocks.back();
+    a.left = size;
+  }
+  uint32_t n = (uint32_t)s.size();
+  memcpy(a.cur, &n, sizeof(n));
+  char *text = a.cur + sizeof(n);
+  memcpy(text, s.data(), s.size());
+  text[s.size()] = '\0';
+  a.cur += need;
+  a.left -= need;
+  a.bytes += need;
+  a.values.insert(std::string_view(text, s.size()));
+  return text;
+}
+
+size_t Str::arena_bytes() {
+  Arena &a = arena();
+  std::lock_guard<std::mutex> lock(a.mu);
+  return a.bytes;
+}
+
+Text::Rep *Text::make(std::string_view s) {
+  if (s.empty())
+    return nullptr;
+  void *mem = malloc(offsetof(Rep, text) + s.size() + 1);
+  if (!mem)
+    throw std::bad_alloc();
+  Rep *p = new (mem) Rep;
+  p->refs.store(1, std::memory_order_relaxed);
+  p->size = (uint32_t)s.size();
+  memcpy(p->text, s.data(), s.size());
+  p->text[s.size()] = '\0';
+  return p;
+}
+
+void Text::destroy(Rep *p) {
+  p->~Rep();
+  free(p);
+}
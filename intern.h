@@ -0,0 +1,225 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// Interned immutable strings. Every distinct value is stored once, NUL
+// terminated, in a process-wide arena that is never freed, so a Str is a
+// single pointer: copies are free, equality is a pointer compare, and the
+// text stays valid for the life of the process. Interning takes a lock and
+// may be called from any thread. Since nothing is ever freed, Str is for
+// values drawn from a small set that recurs, such as channel fields; see
+// Text for the rest.
+class Str {
+public:
+  Str() = default;
+  Str(std::string_view s) : p_(intern(s)) {}
+  Str(const std::string &s) : Str(std::string_view(s)) {}
+  Str(const char *s) : Str(std::string_view(s)) {}
+
+  const char *c_str() const { return p_; }
+  size_t size() const { return length_of(p_); }
+  bool empty() const { return p_ == EMPTY; }
+  std::string_view view() const { return {p_, size()}; }
+  std::string str() const { return std::string(view()); }
+  operator std::string_view() const { return view(); }
+
+  bool operator==(const Str &o) const { return p_ == o.p_; }
+  bool operator!=(const Str &o) const { return p_ != o.p_; }
+  // Hidden friends, so they never make comparisons between other
+  // string types ambiguous.
+  friend bool operator==(const Str &a, std::string_view b) {
+    return a.view() == b;
+  }
+  friend bool operator!=(const Str &a, std::string_view b) {
+    return a.view() != b;
+  }
+  friend bool operator==(const Str &a, const std::string &b) {
+    return a.view() == std::string_view(b);
+  }
+  friend bool operator!=(const Str &a, const std::string &b) {
+    return a.view() != std::string_view(b);
+  }
+  friend bool operator==(const Str &a, const char *b) {
+    return a.view() == std::string_view(b);
+  }
+  friend bool operator!=(const Str &a, const char *b) {
+    return a.view() != std::string_view(b);
+  }
+
+  // Bytes held by the arena, for diagnostics.
+  static size_t arena_bytes();
+
+private:
+  friend class VideoId;
+  // Each value is stored as a 4-byte length followed by the text.
+  static size_t length_of(const char *p) {
+    uint32_t n;
+    memcpy(&n, p - sizeof(n), sizeof(n));
+    return n;
+  }
+  static const char *intern(std::string_view s);
+  static const char *const EMPTY;
+  const char *p_ = EMPTY;
+};
+
+// An immutable string shared by reference count: copies bump an atomic
+// counter, and the text is freed with the last copy. Unlike Str it holds
+// memory only as long as something uses it, which suits text that rarely
+// repeats and keeps coming, like the titles of every page and refresh.
+// Copies may be made and dropped on any thread.
+class Text {
+public:
+  Text() = default;
+  Text(std::string_view s) : p_(make(s)) {}
+  Text(const std::string &s) : Text(std::string_view(s)) {}
+  Text(const char *s) : Text(std::string_view(s)) {}
+  Text(const Text &o) : p_(o.p_) { retain(); }
+  Text(Text &&o) noexcept : p_(o.p_) { o.p_ = nullptr; }
+  Text &operator=(Text o) noexcept {
+    std::swap(p_, o.p_);
+    return *this;
+  }
+  ~Text() { release(); }
+
+  const char *c_str() const { return p_ ? p_->text : ""; }
+  size_t size() const { return p_ ? p_->size : 0; }
+  bool empty() const { return !p_; }
+  std::string_view view() const { return {c_str(), size()}; }
+  std::string str() const { return std::string(view()); }
+  operator std::string_view() const { return view(); }
+  // The very same text, not just equal text; a cheap freshness check.
+  bool same(const Text &o) const { return p_ == o.p_; }
+
+  bool operator==(const Text &o) const { return view() == o.view(); }
+  bool operator!=(const Text &o) const { return view() != o.view(); }
+  friend bool operator==(const Text &a, std::string_view b) {
+    return a.view() == b;
+  }
+  friend bool operator!=(const Text &a, std::string_view b) {
+    return a.view() != b;
+  }
+  friend bool operator==(const Text &a, const std::string &b) {
+    return a.view() == std::string_view(b);
+  }
+  friend bool operator!=(const Text &a, const std::string &b) {
+    return a.view() != std::string_view(b);
+  }
+  friend bool operator==(const Text &a, const char *b) {
+    return a.view() == std::string_view(b);
+  }
+  friend bool operator!=(const Text &a, const char *b) {
+    return a.view() != std::string_view(b);
+  }
+
+private:
+  struct Rep {
+    std::atomic<uint32_t> refs;
+    uint32_t size;
+    char text[1];
+  };
+  static Rep *make(std::string_view s);
+  static void destroy(Rep *p);
+  void retain() const {
+    if (p_)
+      p_->refs.fetch_add(1, std::memory_order_relaxed);
+  }
+  void release() {
+    if (p_ && p_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      destroy(p_);
+  }
+
+  Rep *p_ = nullptr;
+};
+
+// A video id. YouTube ids are 11 characters and are stored inline; longer
+// ids (local files without one) are interned.
+class VideoId {
+public:
+  VideoId() { b_[0] = b_[LEN] = 0; }
+  VideoId(std::string_view s) { assign(s); }
+  VideoId(const std::string &s) : VideoId(std::string_view(s)) {}
+  VideoId(const char *s) : VideoId(std::string_view(s)) {}
+
+  const char *c_str() const { return external() ? ext() : b_; }
+  size_t size() const {
+    return external() ? Str::length_of(ext()) : (uint8_t)b_[LEN];
+  }
+  bool empty() const { return b_[LEN] == 0; }
+  std::string_view view() const { return {c_str(), size()}; }
+  std::string str() const { return std::string(view()); }
+  operator std::string_view() const { return view(); }
+
+  bool operator==(const VideoId &o) const { return view() == o.view(); }
+  bool operator!=(const VideoId &o) const { return !(*this == o); }
+  friend bool operator==(const VideoId &a, std::string_view b) {
+    return a.view() == b;
+  }
+  friend bool operator!=(const VideoId &a, std::string_view b) {
+    return a.view() != b;
+  }
+  friend bool operator==(const VideoId &a, const std::string &b) {
+    return a.view() == std::string_view(b);
+  }
+  friend bool operator!=(const VideoId &a, const std::string &b) {
+    return a.view() != std::string_view(b);
+  }
+  friend bool operator==(const VideoId &a, const char *b) {
+    return a.view() == std::string_view(b);
+  }
+  friend bool operator!=(const VideoId &a, const char *b) {
+    return a.view() != std::string_view(b);
+  }
+
+private:
+  // b_ holds the NUL-terminated id, or a pointer to the interned one, and
+  // its last byte holds the length or EXT.
+  static const size_t LEN = 15;
+  static const char EXT = '\x7f';
+
+  bool external() const { return b_[LEN] == EXT; }
+  const char *ext() const {
+    const char *p;
+    memcpy(&p, b_, sizeof(p));
+    return p;
+  }
+  void assign(std::string_view s) {
+    if (s.size() < LEN) {
+      memcpy(b_, s.data(), s.size());
+      b_[s.size()] = '\0';
+      b_[LEN] = (char)s.size();
+    } else {
+      const char *p = Str::intern(s);
+      memcpy(b_, &p, sizeof(p));
+      b_[LEN] = EXT;
+    }
+  }
+
+  char b_[LEN + 1];
+};
+
+namespace std {
+template <> struct hash<Str> {
+  size_t operator()(const Str &s) const {
+    return hash<const char *>()(s.c_str());
+  }
+};
+template <> struct hash<Text> {
+  size_t operator()(const Text &s) const {
+    return hash<string_view>()(s.view());
+  }
+};
+template <> struct hash<VideoId> {
+  size_t operator()(const VideoId &id) const {
+    return hash<string_view>()(id.view());
+  }
+};
+} // namespace std
+
+#endif
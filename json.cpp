@@ -0,0 +1,205 @@
+#include "json.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+JsonObject::JsonObject(std::string_view text) : s_(text) {
+  skip_ws();
+  ok_ = pos_ < s_.size() && s_[pos_] == '{';
+  ++pos_;
+}
+
+void JsonObject::skip_ws() {
+  while (pos_ < s_.size() && (s_[pos_] == ' ' || s_[pos_] == '\t' ||
+                              s_[pos_] == '\n' || s_[pos_] == '\r'))
+    ++pos_;
+}
+
+// pos_ is on the opening quote; leaves it after the closing one.
+bool JsonObject::skip_string() {
+  ++pos_;
+  for (;;) {
+    const void *q = memchr(s_.data() + pos_, '"', s_.size() - pos_);
+    if (!q)
+      return false;
+    size_t end = (size_t)((const char *)q - s_.data());
+    // The quote is escaped when preceded by an odd number of backslashes.
+    size_t bs = 0;
+    while (end - bs > pos_ && s_[end - bs - 1] == '\\')
+      ++bs;
+    pos_ = end + 1;
+    if (bs % 2 == 0)
+      return true;
+  }
+}
+
+bool JsonObject::skip_value() {
+  skip_ws();
+  if (pos_ >= s_.size())
+    return false;
+  char c = s_[pos_];
+  if (c == '"')
+    return skip_string();
+  if (c == '{' || c == '[') {
+    int depth = 0;
+    while (pos_ < s_.size()) {
+      c = s_[pos_];
+      if (c == '"') {
+        if (!skip_string())
+          return false;
+        continue;
+      }
+      if (c == '{' || c == '[')
+        ++depth;
+      else if ((c == '}' || c == ']') && --depth == 0) {
+        ++pos_;
+        return true;
+      }
+      ++pos_;
+    }
+    return false;
+  }
+  // Number or literal.
+  while (pos_ < s_.size() && s_[pos_] != ',' && s_[pos_] != '}' &&
+         s_[pos_] != ']' && s_[pos_] != ' ' && s_[pos_] != '\n')
+    ++pos_;
+  return true;
+}
+
+bool JsonObject::next(std::string_view &key, std::string_view &value) {
+  if (!ok_)
+    return false;
+  skip_ws();
+  if (pos_ < s_.size() && s_[pos_] == ',') {
+    ++pos_;
+    skip_ws();
+  }
+  if (pos_ >= s_.size() || s_[pos_] != '"') {
+    ok_ = false;
+    return false;
+  }
+  size_t k = pos_;
+  if (!skip_string()) {
+    ok_ = false;
+    return false;
+  }
+  key = s_.substr(k + 1, pos_ - k - 2);
+  skip_ws();
+  if (pos_ >= s_.size() || s_[pos_] != ':') {
+    ok_ = false;
+    return false;
+  }
+  ++pos_;
+  skip_ws();
+  size_t v = pos_;
+  if (!skip_value()) {
+    ok_ = false;
+    return false;
+  }
+  value = s_.substr(v, pos_ - v);
+  return true;
+}
+
+static void put_utf8(std::string &out, uint32_t cp) {
+  if (cp < 0x80) {
+    out += (char)cp;
+  } else if (cp < 0x800) {
+    out += (char)(0xC0 | (cp >> 6));
+    out += (char)(0x80 | (cp & 0x3F));
+  } else if (cp < 0x10000) {
+    out += (char)(0xE0 | (cp >> 12));
+    out += (char)(0x80 | ((cp >> 6) & 0x3F));
+    out += (char)(0x80 | (cp & 0x3F));
+  } else {
+    out += (char)(0xF0 | (cp >> 18));
+    out += (char)(0x80 | ((cp >> 12) & 0x3F));
+    out += (char)(0x80 | ((cp >> 6) & 0x3F));
+    out += (char)(0x80 | (cp & 0x3F));
+  }
+}
+
+static bool read_hex4(std::string_view s, size_t at, uint32_t &out) {
+  if (at + 4 > s.size())
+    return false;
+  out = 0;
+  for (size_t i = at; i < at + 4; ++i) {
+    char c = s[i];
+    out <<= 4;
+    if (c >= '0' && c <= '9')
+      out |= (uint32_t)(c - '0');
+    else if (c >= 'a' && c <= 'f')
+      out |= (uint32_t)(c - 'a' + 10);
+    else if (c >= 'A' && c <= 'F')
+      out |= (uint32_t)(c - 'A' + 10);
+    else
+      return false;
+  }
+  return true;
+}
+
+std::string_view json_string(std::string_view raw, std::string &scratch) {
+  if (raw.size() < 2 || raw.front() != '"' || raw.back() != '"')
+    return std::string_view();
+  std::string_view body = raw.substr(1, raw.size() - 2);
+  size_t bs = body.find('\\');
+  if (bs == std::string_view::npos)
+    return body;
+
+  scratch.assign(body.data(), bs);
+  for (size_t i = bs; i < body.size(); ++i) {
+    char c = body[i];
+    if (c != '\\' || i + 1 == body.size()) {
+      scratch += c;
+      continue;
+    }
+    char e = body[++i];
+    switch (e) {
+    case 'n':
+      scratch += '\n';
+      break;
+    case 't':
+      scratch += '\t';
+      break;
+    case 'r':
+      scratch += '\r';
+      break;
+    case 'b':
+      scratch += '\b';
+      break;
+    case 'f':
+      scratch += '\f';
+      break;
+    case 'u': {
+      uint32_t cp;
+      if (!read_hex4(body, i + 1, cp))
+        break;
+      i += 4;
+      uint32_t lo;
+      if (cp >= 0xD800 && cp < 0xDC00 && i + 2 < body.size() &&
+          body[i + 1] == '\\' && body[i + 2] == 'u' &&
+          read_hex4(body, i + 3, lo) && lo >= 0xDC00 && lo < 0xE000) {
+        cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+        i += 6;
+      }
+      put_utf8(scratch, cp);
+      break;
+    }
+    default: // '"', '\\', '/'
+      scratch += e;
+    }
+  }
+  return scratch;
+}
+
+bool json_number(std::string_view raw, double &out) {
+  if (raw.empty() || !(raw[0] == '-' || (raw[0] >= '0' && raw[0] <= '9')))
+    return false;
+  char buf[64];
+  size_t n = raw.size() < sizeof(buf) - 1 ? raw.size() : sizeof(buf) - 1;
+  memcpy(buf, raw.data(), n);
+  buf[n] = '\0';
+  char *end;
+  out = strtod(buf, &end);
+  return end != buf;
+}
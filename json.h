@@ -0,0 +1,37 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <string>
+#include <string_view>
+
+// Just enough JSON for yt-dlp's one-object-per-line output. JsonObject
+// walks the members of a top-level object without building a tree: keys
+// and values come back as views of the raw text, and nested objects and
+// arrays are skipped in one pass.
+class JsonObject {
+public:
+  explicit JsonObject(std::string_view text);
+
+  // Next member; key is the undecoded key and value the raw JSON of its
+  // value. Returns false at the end of the object or on malformed input.
+  bool next(std::string_view &key, std::string_view &value);
+
+private:
+  void skip_ws();
+  bool skip_string();
+  bool skip_value();
+
+  std::string_view s_;
+  size_t pos_ = 0;
+  bool ok_ = false;
+};
+
+// A string value, decoded. Returns a view of raw itself when the string
+// has no escapes and otherwise decodes into scratch. null and non-string
+// values give an empty string.
+std::string_view json_string(std::string_view raw, std::string &scratch);
+
+// A number value; false for null and anything that is not a number.
+bool json_number(std::string_view raw, double &out);
+
+#endif
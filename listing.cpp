@@ -0,0 +1,114 @@
+#include "listing.h"
+
+#include "json.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+
+LineReader::LineReader(int fd, size_t block) : fd_(fd), buf_(block) {}
+
+bool LineReader::fill() {
+  if (begin_ > 0) {
+    memmove(buf_.data(), buf_.data() + begin_, end_ - begin_);
+    end_ -= begin_;
+    begin_ = 0;
+  }
+  if (end_ == buf_.size())
+    buf_.resize(buf_.size() * 2);
+  for (;;) {
+    ssize_t n = read(fd_, buf_.data() + end_, buf_.size() - end_);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0) {
+      eof_ = true;
+      return false;
+    }
+    end_ += (size_t)n;
+    return true;
+  }
+}
+
+bool LineReader::next(std::string_view &line) {
+  for (;;) {
+    const char *from = buf_.data() + begin_ + scanned_;
+    size_t left = end_ - begin_ - scanned_;
+    const char *nl = (const char *)memchr(from, '\n', left);
+    if (nl) {
+      size_t len = (size_t)(nl - (buf_.data() + begin_));
+      line = std::string_view(buf_.data() + begin_, len);
+      begin_ += len + 1;
+      scanned_ = 0;
+      return true;
+    }
+    scanned_ = end_ - begin_;
+    if (eof_ || !fill()) {
+      if (begin_ == end_)
+        return false;
+      line = std::string_view(buf_.data() + begin_, end_ - begin_);
+      begin_ = end_;
+      scanned_ = 0;
+      return true;
+    }
+  }
+}
+
+// yt-dlp prints upload_date as "YYYYMMDD"; flat listings sometimes carry
+// only a unix timestamp.
+static uint32_t date_from_timestamp(double ts) {
+  time_t t = (time_t)ts;
+  struct tm tm;
+  if (!gmtime_r(&t, &tm))
+    return 0;
+  return (uint32_t)((tm.tm_year + 1900) * 10000 + (tm.tm_mon + 1) * 100 +
+                    tm.tm_mday);
+}
+
+bool parse_listing_json(std::string_view line, Video &out) {
+  out = Video();
+  JsonObject obj(line);
+  std::string_view key, value, uploader, uploader_url;
+  std::string scratch;
+  double num, timestamp = 0;
+  while (obj.next(key, value)) {
+    if (key == "id")
+      out.id = json_string(value, scratch);
+    else if (key == "title")
+      out.title = json_string(value, scratch);
+    else if (key == "channel_url")
+      out.channel_url = json_string(value, scratch);
+    else if (key == "channel")
+      out.channel_name = json_string(value, scratch);
+    else if (key == "channel_id")
+      out.channel_id = json_string(value, scratch);
+    else if (key == "uploader")
+      uploader = value;
+    else if (key == "uploader_url")
+      uploader_url = value;
+    else if (key == "duration" && json_number(value, num) && num > 0)
+      out.duration = (uint32_t)(num + 0.5);
+    else if (key == "view_count" && json_number(value, num) && num > 0)
+      out.view_count = (uint64_t)num;
+    else if (key == "upload_date")
+      out.upload_date =
+          (uint32_t)strtoul(std::string(json_string(value, scratch)).c_str(),
+                            nullptr, 10);
+    else if (key == "timestamp" && json_number(value, num))
+      timestamp = num;
+  }
+  if (out.id.empty())
+    return false;
+
+  if (out.channel_name.empty() && !uploader.empty())
+    out.channel_name = json_string(uploader, scratch);
+  if (out.channel_url.empty() && !uploader_url.empty())
+    out.channel_url = json_string(uploader_url, scratch);
+  if (out.channel_url.empty() && !out.channel_id.empty())
+    out.channel_url =
+        "https://www.youtube.com/channel/" + out.channel_id.str();
+  if (out.upload_date == 0 && timestamp > 0)
+    out.upload_date = date_from_timestamp(timestamp);
+  return true;
+}
@@ -0,0 +1,36 @@
+#ifndef LISTING_H
+#define LISTING_H
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "types.h"
+
+// Streaming line reader over a file descriptor. Reads large blocks and
+// splits them with memchr, handing out lines as views into its buffer, so
+// a line is never copied and has no length limit: the buffer grows to fit.
+class LineReader {
+public:
+  explicit LineReader(int fd, size_t block = 64 * 1024);
+
+  // The next line without its '\n', valid until the next call. A final
+  // line without a newline is returned too.
+  bool next(std::string_view &line);
+
+private:
+  bool fill();
+
+  int fd_;
+  std::vector<char> buf_;
+  size_t begin_ = 0, end_ = 0;
+  size_t scanned_ = 0; // bytes after begin_ known to hold no '\n'
+  bool eof_ = false;
+};
+
+// Parse one line of yt-dlp -j output. Fields are read as views of the line
+// and interned once into the Video; a missing channel URL is derived from
+// the channel id. Returns false for lines that are not an object with an id.
+bool parse_listing_json(std::string_view line, Video &out);
+
+#endif
@@ -2,24 +2,29 @@
 #include <ncurses.h>
 #include <unistd.h>
 
+#include "config.h"
+#include "perf.h"
+#include "persist.h"
+#include "trace.h"
 #include "ui.h"
 #include "utils.h"
 
 int main() {
-  mkdirs();
-  load_search_hist();
-  load_history();
+  perf_launch();
+  trace_init();
+  load_state_async();
   signal(SIGPIPE, SIG_IGN);
   init_ui();
   bool run = true;
   while (run) {
-    draw();
-    redraw_thumbnail();
-    run = handle_input();
+    run = ui_frame();
     napms(16);
   }
   save_history();
+  persist_flush();
   hide_thumbnail();
   cleanup_ui();
+  perf_dump(PERF_STATS_FILE);
+  trace_flush();
   return 0;
 }
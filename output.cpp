@@ -0,0 +1,217 @@
+#include "output.h"
+#include "perf.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <fcntl.h>
+#include <ncurses.h>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace {
+
+const char SYNC_BEGIN[] = "\033[?2026h";
+const char SYNC_END[] = "\033[?2026l";
+
+FILE *g_screen = nullptr; // what ncurses writes to
+int g_tty = -1;           // where the screen goes
+int g_queue_fd = -1;      // where queued bytes go, when not with the screen
+bool g_sync = false;
+std::string g_queue;
+std::string g_frame;
+uint64_t g_epoch = 0;
+
+struct termios g_saved_modes;
+bool g_modes_saved = false;
+
+volatile sig_atomic_t g_quit = 0;
+volatile sig_atomic_t g_resized = 0;
+volatile sig_atomic_t g_stop = 0;
+
+void on_signal(int sig) {
+  if (sig == SIGWINCH)
+    g_resized = 1;
+  else if (sig == SIGTSTP)
+    g_stop = 1;
+  else
+    g_quit = 1;
+}
+
+void catch_signals() {
+  struct sigaction sa = {};
+  sa.sa_handler = on_signal;
+  sigemptyset(&sa.sa_mask);
+  for (int sig : {SIGINT, SIGTERM, SIGHUP, SIGWINCH, SIGTSTP})
+    sigaction(sig, &sa, nullptr);
+}
+
+// What initscr() and cbreak() would set up: keys one at a time, no echo,
+// signals and CR to NL translation left as they are.
+void set_modes() {
+  if (!g_modes_saved)
+    return;
+  struct termios t = g_saved_modes;
+  t.c_lflag &= ~(tcflag_t)(ICANON | ECHO);
+  t.c_cc[VMIN] = 1;
+  t.c_cc[VTIME] = 0;
+  tcsetattr(STDIN_FILENO, TCSADRAIN, &t);
+}
+
+void restore_modes() {
+  if (g_modes_saved)
+    tcsetattr(STDIN_FILENO, TCSADRAIN, &g_saved_modes);
+}
+
+FILE *open_screen() {
+  int fd = memfd_create("ytui-screen", MFD_CLOEXEC);
+  FILE *f = fd >= 0 ? fdopen(fd, "w+") : tmpfile();
+  if (!f) {
+    perror("ytui: screen buffer");
+    exit(1);
+  }
+  return f;
+}
+
+void start_curses(FILE *in) {
+  const char *term = getenv("TERM");
+  if (!term || !*term)
+    term = "xterm-256color";
+  g_screen = open_screen();
+  if (!newterm(term, g_screen, in)) {
+    restore_modes();
+    fprintf(stderr, "ytui: cannot set up a screen for TERM=%s\n", term);
+    exit(1);
+  }
+}
+
+void write_all(int fd, const char *p, size_t n) {
+  while (n > 0) {
+    ssize_t w = write(fd, p, n);
+    if (w < 0 && errno == EINTR)
+      continue;
+    if (w <= 0)
+      return;
+    p += w;
+    n -= (size_t)w;
+  }
+}
+
+// Moves what ncurses wrote since the last call to the end of out.
+void take_screen(std::string &out) {
+  fflush(g_screen);
+  int fd = fileno(g_screen);
+  off_t n = lseek(fd, 0, SEEK_CUR);
+  if (n <= 0)
+    return;
+  size_t at = out.size();
+  out.resize(at + (size_t)n);
+  ssize_t got = pread(fd, &out[at], (size_t)n, 0);
+  out.resize(at + (size_t)std::max<ssize_t>(got, 0));
+  perf_count(PERF_SCREEN_BYTES, out.size() - at);
+  if (ftruncate(fd, 0) != 0)
+    perror("ytui: screen buffer");
+  rewind(g_screen);
+}
+
+void send_frame() {
+  g_frame.clear();
+  if (g_sync)
+    g_frame = SYNC_BEGIN;
+  size_t empty = g_frame.size();
+  take_screen(g_frame);
+  if (g_queue_fd >= 0) {
+    if (!g_queue.empty())
+      write_all(g_queue_fd, g_queue.data(), g_queue.size());
+  } else {
+    g_frame += g_queue;
+  }
+  g_queue.clear();
+  if (g_frame.size() == empty)
+    return;
+  if (g_sync)
+    g_frame += SYNC_END;
+  TraceSpan span("write frame");
+  perf_count(PERF_TTY_WRITES);
+  write_all(g_tty, g_frame.data(), g_frame.size());
+}
+
+// Takes up the terminal's current size and has the next frame redraw
+// everything.
+void follow_size() {
+  struct winsize ws = {};
+  if (ioctl(g_tty, TIOCGWINSZ, &ws) == 0 && ws.ws_row && ws.ws_col &&
+      (ws.ws_row != LINES || ws.ws_col != COLS))
+    resizeterm(ws.ws_row, ws.ws_col);
+  clearok(curscr, TRUE);
+  ++g_epoch;
+}
+
+void suspend() {
+  endwin();
+  send_frame();
+  restore_modes();
+  signal(SIGTSTP, SIG_DFL);
+  raise(SIGTSTP);
+  // Continued.
+  catch_signals();
+  set_modes();
+  follow_size();
+}
+
+} // namespace
+
+void output_init() {
+  g_tty = STDOUT_FILENO;
+  g_sync = true;
+  if (tcgetattr(STDIN_FILENO, &g_saved_modes) == 0) {
+    g_modes_saved = true;
+    set_modes();
+  }
+  // Before newterm(), which leaves handlers already in place alone.
+  catch_signals();
+  start_curses(stdin);
+  follow_size();
+}
+
+void output_init_headless(FILE *out) {
+  g_tty = fileno(out);
+  static FILE *in = fopen("/dev/null", "r");
+  start_curses(in);
+}
+
+void output_end() {
+  endwin();
+  send_frame();
+  restore_modes();
+}
+
+void output_queue_to(int fd) { g_queue_fd = fd; }
+
+void output_queue(std::string_view bytes) { g_queue.append(bytes); }
+
+void output_present() {
+  doupdate();
+  send_frame();
+}
+
+bool output_poll() {
+  if (g_stop) {
+    g_stop = 0;
+    suspend();
+  }
+  if (g_resized) {
+    g_resized = 0;
+    follow_size();
+  }
+  return !g_quit;
+}
+
+uint64_t output_epoch() { return g_epoch; }
+
+int output_tty() { return g_sync ? g_tty : -1; }
@@ -0,0 +1,42 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+
+// Everything the UI sends to the terminal goes through here. ncurses draws
+// into a memory file instead of the terminal, and output_present() sends
+// what it wrote for the frame together with the bytes queued by
+// output_queue() (thumbnail graphics, terminal queries) in a single write,
+// bracketed as a synchronized update (DEC mode 2026) so text and images
+// change together. A frame that changes nothing writes nothing.
+//
+// Since ncurses never sees the terminal, its modes, its size and job
+// control are handled here as well. UI thread only.
+
+// Take over the terminal on stdin and stdout and start ncurses on it.
+void output_init();
+// Start ncurses for a headless run: the screen goes to out, with no
+// synchronized update markers, and the size comes from LINES and COLUMNS.
+void output_init_headless(FILE *out);
+// Stop ncurses and give the terminal back as it was.
+void output_end();
+
+// Send queued bytes to fd rather than with the screen. For headless runs.
+void output_queue_to(int fd);
+void output_queue(std::string_view bytes);
+// Update the screen from the windows marked with wnoutrefresh() and send
+// the frame.
+void output_present();
+
+// Call once per frame, before drawing: follows window size changes and
+// suspends on ^Z. False once SIGINT, SIGTERM or SIGHUP asked to quit.
+bool output_poll();
+// Changes whenever the terminal is redrawn from scratch (resize, resume),
+// which takes graphics placed on it away.
+uint64_t output_epoch();
+// The terminal, for ioctls; -1 when headless.
+int output_tty();
+
+#endif
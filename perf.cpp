@@ -0,0 +1,168 @@
+#include "perf.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+namespace {
+
+// Values below 8 ns get a bucket each; above, bucket 8 * (e - 2) + s holds
+// the values whose top bit is e and next three bits are s.
+const size_t BUCKETS = 62 * 8;
+
+struct Histogram {
+  std::atomic<uint64_t> bucket[BUCKETS];
+  std::atomic<uint64_t> count, sum, max;
+};
+
+Histogram g_hist[PERF_STAGE_COUNT];
+std::atomic<uint64_t> g_counter[PERF_COUNTER_COUNT];
+std::atomic<uint64_t> g_key_at{0};
+std::atomic<uint64_t> g_launch_at{0};
+
+const char *const STAGE_NAMES[PERF_STAGE_COUNT] = {
+    "frame",        "draw",        "input",        "key to frame",
+    "fetch",        "thumb fetch", "thumb decode", "thumb scale",
+    "thumb upload", "thumb draw",  "first frame",  "state load"};
+
+size_t bucket_of(uint64_t ns) {
+  if (ns < 8)
+    return (size_t)ns;
+  unsigned e = 63 - (unsigned)__builtin_clzll(ns);
+  return (e - 2) * 8 + ((ns >> (e - 3)) & 7);
+}
+
+// Midpoint of the values in bucket b.
+uint64_t bucket_value(size_t b) {
+  if (b < 8)
+    return b;
+  unsigned e = (unsigned)(b / 8) + 2;
+  uint64_t lo = (8 + b % 8) << (e - 3);
+  return lo + (((uint64_t)1 << (e - 3)) >> 1);
+}
+
+std::string format_ns(uint64_t ns) {
+  char buf[32];
+  if (ns < 1000)
+    snprintf(buf, sizeof(buf), "%lluns", (unsigned long long)ns);
+  else if (ns < 1000000)
+    snprintf(buf, sizeof(buf), "%.0fus", ns / 1e3);
+  else if (ns < 1000000000)
+    snprintf(buf, sizeof(buf), "%.1fms", ns / 1e6);
+  else
+    snprintf(buf, sizeof(buf), "%.2fs", ns / 1e9);
+  return buf;
+}
+
+std::string hit_rate(const char *name, PerfCounter hit, PerfCounter miss) {
+  uint64_t h = g_counter[hit].load(std::memory_order_relaxed);
+  uint64_t m = g_counter[miss].load(std::memory_order_relaxed);
+  char buf[96];
+  if (h + m == 0)
+    snprintf(buf, sizeof(buf), "%-13s -", name);
+  else
+    snprintf(buf, sizeof(buf), "%-13s %llu hit %llu miss (%.0f%%)", name,
+             (unsigned long long)h, (unsigned long long)m,
+             100.0 * (double)h / (double)(h + m));
+  return buf;
+}
+
+} // namespace
+
+uint64_t perf_now() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void perf_record(PerfStage stage, uint64_t ns) {
+  Histogram &h = g_hist[stage];
+  h.bucket[bucket_of(ns)].fetch_add(1, std::memory_order_relaxed);
+  h.count.fetch_add(1, std::memory_order_relaxed);
+  h.sum.fetch_add(ns, std::memory_order_relaxed);
+  uint64_t m = h.max.load(std::memory_order_relaxed);
+  while (ns > m &&
+         !h.max.compare_exchange_weak(m, ns, std::memory_order_relaxed))
+    ;
+}
+
+void perf_count(PerfCounter counter, uint64_t n) {
+  g_counter[counter].fetch_add(n, std::memory_order_relaxed);
+}
+
+uint64_t perf_quantile(PerfStage stage, double q) {
+  const Histogram &h = g_hist[stage];
+  uint64_t total = h.count.load(std::memory_order_relaxed);
+  if (total == 0)
+    return 0;
+  uint64_t want = (uint64_t)std::ceil(q * (double)total);
+  if (want == 0)
+    want = 1;
+  uint64_t seen = 0;
+  for (size_t b = 0; b < BUCKETS; ++b) {
+    seen += h.bucket[b].load(std::memory_order_relaxed);
+    if (seen >= want)
+      return std::min(bucket_value(b), h.max.load(std::memory_order_relaxed));
+  }
+  return h.max.load(std::memory_order_relaxed);
+}
+
+// Only the oldest key not yet on screen counts.
+void perf_key_read() {
+  uint64_t none = 0;
+  g_key_at.compare_exchange_strong(none, perf_now());
+}
+
+void perf_launch() { g_launch_at = perf_now(); }
+
+void perf_frame_done() {
+  uint64_t at = g_key_at.exchange(0);
+  if (at)
+    perf_record(PERF_KEY_TO_FRAME, perf_now() - at);
+  at = g_launch_at.exchange(0);
+  if (at)
+    perf_record(PERF_FIRST_FRAME, perf_now() - at);
+}
+
+std::vector<std::string> perf_report() {
+  std::vector<std::string> out;
+  char buf[96];
+  snprintf(buf, sizeof(buf), "%-13s %7s %8s %8s %8s", "stage", "count", "p50",
+           "p99", "max");
+  out.push_back(buf);
+  for (int s = 0; s < PERF_STAGE_COUNT; ++s) {
+    const Histogram &h = g_hist[s];
+    uint64_t n = h.count.load(std::memory_order_relaxed);
+    if (n == 0)
+      continue;
+    snprintf(buf, sizeof(buf), "%-13s %7llu %8s %8s %8s", STAGE_NAMES[s],
+             (unsigned long long)n,
+             format_ns(perf_quantile((PerfStage)s, 0.5)).c_str(),
+             format_ns(perf_quantile((PerfStage)s, 0.99)).c_str(),
+             format_ns(h.max.load(std::memory_order_relaxed)).c_str());
+    out.push_back(buf);
+  }
+  snprintf(buf, sizeof(buf), "%-13s %.1f KiB", "tty graphics",
+           g_counter[PERF_TTY_BYTES].load(std::memory_order_relaxed) / 1024.0);
+  out.push_back(buf);
+  snprintf(buf, sizeof(buf), "%-13s %.1f KiB in %llu writes", "tty screen",
+           g_counter[PERF_SCREEN_BYTES].load(std::memory_order_relaxed) /
+               1024.0,
+           (unsigned long long)g_counter[PERF_TTY_WRITES].load(
+               std::memory_order_relaxed));
+  out.push_back(buf);
+  out.push_back(
+      hit_rate("result cache", PERF_RESULT_CACHE_HIT, PERF_RESULT_CACHE_MISS));
+  out.push_back(
+      hit_rate("thumb cache", PERF_THUMB_CACHE_HIT, PERF_THUMB_CACHE_MISS));
+  return out;
+}
+
+void perf_dump(const std::string &path) {
+  std::ofstream f(path);
+  for (const auto &line : perf_report())
+    f << line << '\n';
+}
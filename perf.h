@@ -0,0 +1,73 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Timing and counting for the overlay (APP_KEY_PERF) and PERF_STATS_FILE.
+// Every stage keeps a histogram of its durations in log-scaled buckets,
+// eight per power of two, so percentiles are accurate to about 9%.
+// Recording is lock-free and may happen on any thread.
+
+enum PerfStage {
+  PERF_FRAME,        // one main loop iteration, without the idle sleep
+  PERF_DRAW,         // draw()
+  PERF_INPUT,        // handle_input() for the keys of a frame
+  PERF_KEY_TO_FRAME, // key read until the frame showing it is out
+  PERF_FETCH,        // one yt-dlp listing
+  PERF_THUMB_FETCH,  // curl for a thumbnail not yet cached
+  PERF_THUMB_DECODE,
+  PERF_THUMB_SCALE,
+  PERF_THUMB_UPLOAD, // building and writing the kitty upload
+  PERF_THUMB_DRAW,   // redraw_thumbnail()
+  PERF_FIRST_FRAME,  // perf_launch() until the first frame is out
+  PERF_STATE_LOAD,   // reading the saved state in the background
+  PERF_STAGE_COUNT
+};
+
+enum PerfCounter {
+  PERF_TTY_BYTES,    // graphics and queries queued with output_queue()
+  PERF_SCREEN_BYTES, // written by ncurses
+  PERF_TTY_WRITES,   // frames sent (see output.h)
+  PERF_RESULT_CACHE_HIT,
+  PERF_RESULT_CACHE_MISS,
+  PERF_THUMB_CACHE_HIT,
+  PERF_THUMB_CACHE_MISS,
+  PERF_COUNTER_COUNT
+};
+
+uint64_t perf_now(); // monotonic nanoseconds
+
+void perf_record(PerfStage stage, uint64_t ns);
+void perf_count(PerfCounter counter, uint64_t n = 1);
+
+// Duration of a stage, in nanoseconds, below which a fraction q of its
+// samples fall; 0 without samples.
+uint64_t perf_quantile(PerfStage stage, double q);
+
+// Key-to-frame latency: a key was read, and a frame has been written.
+void perf_key_read();
+void perf_frame_done();
+// Marks the start of the process; the next perf_frame_done() records the
+// time to the first frame.
+void perf_launch();
+
+// Times the enclosing scope.
+class PerfScope {
+public:
+  explicit PerfScope(PerfStage stage) : stage_(stage), start_(perf_now()) {}
+  ~PerfScope() { perf_record(stage_, perf_now() - start_); }
+  PerfScope(const PerfScope &) = delete;
+  PerfScope &operator=(const PerfScope &) = delete;
+
+private:
+  PerfStage stage_;
+  uint64_t start_;
+};
+
+// The statistics as a table, one line per entry.
+std::vector<std::string> perf_report();
+void perf_dump(const std::string &path);
+
+#endif
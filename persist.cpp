@@ -0,0 +1,139 @@
+#include "persist.h"
+
+#include "config.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <fcntl.h>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+struct Op {
+  bool append;
+  std::string path;
+  std::function<std::string()> render; // replace only
+  std::string data;                    // append only
+  std::string then_remove;
+};
+
+// Deliberately leaked: the detached writer may still be waiting on the
+// condition variables while static destructors run at exit.
+std::mutex &g_mu = *new std::mutex;
+std::condition_variable &g_wake = *new std::condition_variable;
+std::condition_variable &g_idle = *new std::condition_variable;
+std::deque<Op> &g_queue = *new std::deque<Op>;
+bool g_started = false;
+bool g_busy = false;
+bool g_flush = false;
+
+bool write_all(int fd, const std::string &s) {
+  const char *p = s.data();
+  size_t left = s.size();
+  while (left > 0) {
+    ssize_t n = write(fd, p, left);
+    if (n <= 0)
+      return false;
+    p += n;
+    left -= (size_t)n;
+  }
+  return true;
+}
+
+void do_append(const Op &op) {
+  int fd = open(op.path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+                0644);
+  if (fd < 0)
+    return;
+  write_all(fd, op.data);
+  close(fd);
+}
+
+void do_replace(const Op &op) {
+  std::string contents = op.render();
+  std::string tmp = op.path + ".tmp";
+  int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0)
+    return;
+  bool ok = write_all(fd, contents) && fsync(fd) == 0;
+  ok = close(fd) == 0 && ok;
+  if (!ok || rename(tmp.c_str(), op.path.c_str()) != 0) {
+    unlink(tmp.c_str());
+    return;
+  }
+  if (!op.then_remove.empty())
+    unlink(op.then_remove.c_str());
+}
+
+void writer_loop() {
+  std::unique_lock<std::mutex> lock(g_mu);
+  for (;;) {
+    g_wake.wait(lock, [] { return !g_queue.empty(); });
+    g_wake.wait_for(lock, std::chrono::milliseconds(PERSIST_DELAY_MS),
+                    [] { return g_flush; });
+    std::deque<Op> batch;
+    batch.swap(g_queue);
+    g_busy = true;
+    lock.unlock();
+    for (const auto &op : batch) {
+      if (op.append)
+        do_append(op);
+      else
+        do_replace(op);
+    }
+    lock.lock();
+    g_busy = false;
+    if (g_queue.empty()) {
+      g_flush = false;
+      g_idle.notify_all();
+    }
+  }
+}
+
+void enqueue_locked(Op op) {
+  g_queue.push_back(std::move(op));
+  if (!g_started) {
+    g_started = true;
+    std::thread(writer_loop).detach();
+  }
+  g_wake.notify_one();
+}
+
+} // namespace
+
+void persist_replace(const std::string &path,
+                     std::function<std::string()> render,
+                     const std::string &then_remove) {
+  std::lock_guard<std::mutex> lock(g_mu);
+  for (auto &op : g_queue) {
+    if (!op.append && op.path == path) {
+      op.render = std::move(render);
+      op.then_remove = then_remove;
+      return;
+    }
+  }
+  enqueue_locked({false, path, std::move(render), {}, then_remove});
+}
+
+void persist_append(const std::string &path, std::string data) {
+  std::lock_guard<std::mutex> lock(g_mu);
+  if (!g_queue.empty() && g_queue.back().append &&
+      g_queue.back().path == path) {
+    g_queue.back().data += data;
+    return;
+  }
+  enqueue_locked({true, path, nullptr, std::move(data), {}});
+}
+
+void persist_flush() {
+  std::unique_lock<std::mutex> lock(g_mu);
+  if (g_queue.empty() && !g_busy)
+    return;
+  g_flush = true;
+  g_wake.notify_one();
+  g_idle.wait(lock, [] { return g_queue.empty() && !g_busy; });
+}
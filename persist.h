@@ -0,0 +1,25 @@
+#ifndef PERSIST_H
+#define PERSIST_H
+
+#include <functional>
+#include <string>
+
+// Write-behind persistence. A single background thread performs all state
+// file I/O after a short delay, so bursts of changes coalesce into one
+// write and the UI thread never waits on the disk.
+
+// Atomically replace path (temp file + fsync + rename) with the output of
+// render, which runs on the writer thread. A replacement still queued for
+// the same path is superseded. When then_remove is set, that file is
+// deleted once the replacement is in place.
+void persist_replace(const std::string &path,
+                     std::function<std::string()> render,
+                     const std::string &then_remove = std::string());
+
+// Append data to path. Appends are written in the order they were queued.
+void persist_append(const std::string &path, std::string data);
+
+// Block until everything queued so far is on disk. Called on exit.
+void persist_flush();
+
+#endif
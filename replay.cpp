@@ -0,0 +1,290 @@
+// Headless replay: runs the UI loop on a virtual screen, feeds it a key
+// script and reports startup, frame and key-to-frame timings and output
+// volume.
+//
+//   ytui-replay [--json] [--size COLSxROWS] [--capture FILE] [--home DIR]
+//               SCRIPT
+//
+// SCRIPT may be - for standard input. Unless --home is given the run
+// starts from an empty scratch profile; ytui-gen builds large ones.
+// yt-dlp, curl and mpv are whatever PATH finds, so stand-ins give
+// reproducible runs. ncurses output goes to FILE with --capture (and is
+// otherwise discarded after counting), and thumbnail graphics are counted
+// and discarded. Script lines:
+//
+//   # comment
+//   keys TEXT    type TEXT, one key every `every` ms; \n \t \e \\ and
+//                <Up> <Down> <Left> <Right> <Enter> <Esc> <Tab> <BS>
+//                <PgUp> <PgDn> <Home> <End> are understood
+//   every MS     delay between keys (default 30)
+//   sleep MS     keep running frames for MS
+//   idle         run frames until background work is done (at most 30 s)
+//
+// For example, search and scroll through the results:
+//
+//   keys s<Enter>lofi<Enter>
+//   idle
+//   every 16
+//   keys jjjjjjjjjjjjjjjjjjjjkkkkkkkkkk
+//   keys Q
+
+#include "config.h"
+#include "globals.h"
+#include "perf.h"
+#include "persist.h"
+#include "tasks.h"
+#include "trace.h"
+#include "ui.h"
+#include "utils.h"
+#include "youtube.h"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <ncurses.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+const struct {
+  const char *name;
+  int key;
+} KEY_NAMES[] = {{"Up", KEY_UP},       {"Down", KEY_DOWN},
+                 {"Left", KEY_LEFT},   {"Right", KEY_RIGHT},
+                 {"Enter", '\n'},      {"Esc", 27},
+                 {"Tab", '\t'},        {"BS", KEY_BACKSPACE},
+                 {"PgUp", KEY_PPAGE},  {"PgDn", KEY_NPAGE},
+                 {"Home", KEY_HOME},   {"End", KEY_END}};
+
+std::vector<int> parse_keys(const std::string &text) {
+  std::vector<int> keys;
+  for (size_t i = 0; i < text.size(); ++i) {
+    char c = text[i];
+    if (c == '\\' && i + 1 < text.size()) {
+      char e = text[++i];
+      keys.push_back(e == 'n' ? '\n' : e == 't' ? '\t' : e == 'e' ? 27 : e);
+      continue;
+    }
+    if (c == '<') {
+      size_t end = text.find('>', i);
+      bool named = false;
+      for (const auto &k : KEY_NAMES)
+        if (end != std::string::npos &&
+            text.compare(i + 1, end - i - 1, k.name) == 0) {
+          keys.push_back(k.key);
+          i = end;
+          named = true;
+          break;
+        }
+      if (named)
+        continue;
+    }
+    keys.push_back((unsigned char)c);
+  }
+  return keys;
+}
+
+struct Replay {
+  int out_fd = -1;
+  size_t frames = 0, keys = 0;
+  bool running = true;
+  unsigned every_ms = 30;
+
+  // One main loop iteration, paced like main().
+  void frame() {
+    if (!running)
+      return;
+    running = ui_frame();
+    ++frames;
+    napms(16);
+  }
+
+  void run_for(unsigned ms) {
+    uint64_t until = perf_now() + (uint64_t)ms * 1000000;
+    do
+      frame();
+    while (running && perf_now() < until);
+  }
+
+  void type(const std::vector<int> &ks) {
+    for (int k : ks) {
+      if (!running)
+        return;
+      ungetch(k);
+      ++keys;
+      run_for(every_ms);
+    }
+  }
+
+  void idle() {
+    uint64_t until = perf_now() + 30000000000ull;
+    frame();
+    while (running && perf_now() < until &&
+           !(tasks_idle() && !page_loading() && subs_refresh_total == 0))
+      frame();
+  }
+};
+
+uint64_t file_bytes(int fd) {
+  struct stat st;
+  return fd >= 0 && fstat(fd, &st) == 0 ? (uint64_t)st.st_size : 0;
+}
+
+std::string scratch_home() {
+  char tmpl[] = "/tmp/ytui-replay-XXXXXX";
+  const char *d = mkdtemp(tmpl);
+  if (!d) {
+    perror("mkdtemp");
+    exit(1);
+  }
+  return d;
+}
+
+int usage() {
+  fprintf(stderr, "usage: ytui-replay [--json] [--size COLSxROWS] "
+                  "[--capture FILE] [--home DIR] SCRIPT\n");
+  return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  bool json = false;
+  std::string capture, home, script;
+  for (int i = 1; i < argc; ++i) {
+    std::string a = argv[i];
+    if (a == "--json")
+      json = true;
+    else if (a == "--size" && i + 1 < argc) {
+      unsigned cols = 0, rows = 0;
+      if (sscanf(argv[++i], "%ux%u", &cols, &rows) != 2)
+        return usage();
+      setenv("COLUMNS", std::to_string(cols).c_str(), 1);
+      setenv("LINES", std::to_string(rows).c_str(), 1);
+    } else if (a == "--capture" && i + 1 < argc)
+      capture = argv[++i];
+    else if (a == "--home" && i + 1 < argc)
+      home = argv[++i];
+    else if (script.empty() && (a[0] != '-' || a == "-"))
+      script = a;
+    else
+      return usage();
+  }
+  if (script.empty())
+    return usage();
+
+  // The profile paths in config.h are fixed when the process starts, so
+  // switching HOME takes a fresh exec.
+  if (!getenv("YTUI_REPLAY_HOME")) {
+    if (home.empty()) {
+      home = scratch_home();
+      mkdir((home + "/.cache").c_str(), 0755);
+      mkdir((home + "/.config").c_str(), 0755);
+    }
+    setenv("HOME", home.c_str(), 1);
+    setenv("YTUI_REPLAY_HOME", home.c_str(), 1);
+    if (!getenv("COLUMNS"))
+      setenv("COLUMNS", "160", 1);
+    if (!getenv("LINES"))
+      setenv("LINES", "48", 1);
+    execv("/proc/self/exe", argv);
+    perror("execv");
+    return 1;
+  }
+
+  std::ifstream file;
+  if (script != "-")
+    file.open(script);
+  std::istream &in = script == "-" ? std::cin : file;
+  if (!in) {
+    perror(script.c_str());
+    return 1;
+  }
+  FILE *out = capture.empty() ? tmpfile() : fopen(capture.c_str(), "w");
+  int sink = open("/dev/null", O_WRONLY | O_CLOEXEC);
+  if (!out || sink < 0) {
+    perror("output");
+    return 1;
+  }
+
+  // Started as main() does. Startup is timed from here, so it leaves out
+  // exec and dynamic linking.
+  perf_launch();
+  trace_init();
+  load_state_async();
+  signal(SIGPIPE, SIG_IGN);
+  init_ui_headless(out);
+  set_graphics_output(sink);
+
+  Replay r;
+  r.out_fd = fileno(out);
+  uint64_t start = perf_now();
+  std::string line;
+  while (r.running && std::getline(in, line)) {
+    size_t sp = line.find(' ');
+    std::string cmd = line.substr(0, sp);
+    std::string arg = sp == std::string::npos ? "" : line.substr(sp + 1);
+    if (cmd.empty() || cmd[0] == '#')
+      continue;
+    if (cmd == "keys")
+      r.type(parse_keys(arg));
+    else if (cmd == "every")
+      r.every_ms = (unsigned)atoi(arg.c_str());
+    else if (cmd == "sleep")
+      r.run_for((unsigned)atoi(arg.c_str()));
+    else if (cmd == "idle")
+      r.idle();
+    else
+      fprintf(stderr, "ytui-replay: unknown command: %s\n", cmd.c_str());
+  }
+  double seconds = (double)(perf_now() - start) / 1e9;
+  cleanup_ui();
+  persist_flush();
+  trace_flush();
+  fflush(out);
+
+  uint64_t screen = file_bytes(r.out_fd);
+  std::vector<std::string> table = perf_report();
+  if (json) {
+    printf("{\"frames\": %zu, \"keys\": %zu, \"seconds\": %.3f, "
+           "\"screen_bytes\": %llu, \"bytes_per_frame\": %.1f, "
+           "\"first_frame_ns\": %llu, \"state_load_ns\": %llu",
+           r.frames, r.keys, seconds, (unsigned long long)screen,
+           r.frames ? (double)screen / (double)r.frames : 0.0,
+           (unsigned long long)perf_quantile(PERF_FIRST_FRAME, 1),
+           (unsigned long long)perf_quantile(PERF_STATE_LOAD, 1));
+    const struct {
+      const char *name;
+      PerfStage stage;
+    } stages[] = {{"frame", PERF_FRAME},
+                  {"key_to_frame", PERF_KEY_TO_FRAME},
+                  {"draw", PERF_DRAW},
+                  {"input", PERF_INPUT}};
+    for (const auto &s : stages)
+      printf(", \"%s_p50_ns\": %llu, \"%s_p99_ns\": %llu", s.name,
+             (unsigned long long)perf_quantile(s.stage, 0.5), s.name,
+             (unsigned long long)perf_quantile(s.stage, 0.99));
+    printf("}\n");
+  } else {
+    printf("%zu frames, %zu keys in %.2f s; %llu screen bytes (%.0f per "
+           "frame)\n",
+           r.frames, r.keys, seconds, (unsigned long long)screen,
+           r.frames ? (double)screen / (double)r.frames : 0.0);
+    for (const auto &l : table)
+      printf("%s\n", l.c_str());
+  }
+
+  if (home.empty()) {
+    std::string scratch = getenv("YTUI_REPLAY_HOME");
+    if (scratch.compare(0, 17, "/tmp/ytui-replay-") == 0)
+      return system(("rm -rf '" + scratch + "'").c_str()) == 0 ? 0 : 1;
+  }
+  return 0;
+}
@@ -0,0 +1,39 @@
+#include "tasks.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+static std::mutex g_main_mu;
+static std::vector<std::function<void()>> g_main_queue;
+static std::atomic<size_t> g_running{0};
+
+void run_async(std::function<void()> fn) {
+  ++g_running;
+  std::thread([fn = std::move(fn)] {
+    fn();
+    --g_running;
+  }).detach();
+}
+
+void post_main(std::function<void()> fn) {
+  std::lock_guard<std::mutex> lock(g_main_mu);
+  g_main_queue.push_back(std::move(fn));
+}
+
+void run_main_tasks() {
+  std::vector<std::function<void()>> batch;
+  {
+    std::lock_guard<std::mutex> lock(g_main_mu);
+    batch.swap(g_main_queue);
+  }
+  for (auto &fn : batch)
+    fn();
+}
+
+bool tasks_idle() {
+  std::lock_guard<std::mutex> lock(g_main_mu);
+  return g_running == 0 && g_main_queue.empty();
+}
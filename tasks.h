@@ -0,0 +1,19 @@
+#ifndef TASKS_H
+#define TASKS_H
+
+#include <functional>
+
+// Run fn on a detached worker thread.
+void run_async(std::function<void()> fn);
+
+// Queue fn to run on the UI thread; workers use this to hand results back
+// without touching global state themselves.
+void post_main(std::function<void()> fn);
+
+// Drain queued UI-thread work. Called once per main-loop iteration.
+void run_main_tasks();
+
+// True when no run_async work is running and no UI-thread work is queued.
+bool tasks_idle();
+
+#endif
@@ -0,0 +1,172 @@
+#include "trace.h"
+
+#include "config.h"
+#include "perf.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+bool trace_on = false;
+
+namespace {
+
+struct Event {
+  const char *name;
+  uint64_t start, end;
+};
+
+// Written only by its thread; head counts every event ever recorded, so
+// the live ones are the last min(head, CAPACITY).
+struct Ring {
+  static const size_t CAPACITY = 1 << 16;
+  long tid = 0;
+  std::atomic<uint64_t> head{0};
+  Event events[CAPACITY];
+};
+
+// Events of threads that have exited, the oldest overwritten once
+// RETIRED_CAPACITY of them are kept.
+const size_t RETIRED_CAPACITY = 1 << 16;
+struct Retired {
+  long tid;
+  Event e;
+};
+
+// Never freed, so detached threads finishing during exit can still retire
+// their rings.
+struct Store {
+  std::mutex mu;
+  std::vector<Ring *> live, free;
+  std::vector<Retired> retired; // allocated by the first retire()
+  uint64_t retired_head = 0;
+};
+
+std::string g_path;
+
+Store &store() {
+  static Store *s = new Store;
+  return *s;
+}
+
+// A finished thread's events move to the retired buffer and its ring goes
+// back to the free list, so threads started per task reuse a few rings
+// instead of leaving one behind each.
+void retire(Ring *r) {
+  Store &s = store();
+  std::lock_guard<std::mutex> lock(s.mu);
+  if (s.retired.empty())
+    s.retired.resize(RETIRED_CAPACITY);
+  uint64_t head = r->head.load(std::memory_order_relaxed);
+  uint64_t from = head > Ring::CAPACITY ? head - Ring::CAPACITY : 0;
+  for (uint64_t i = from; i < head; ++i)
+    s.retired[s.retired_head++ % RETIRED_CAPACITY] = {
+        r->tid, r->events[i % Ring::CAPACITY]};
+  for (size_t i = 0; i < s.live.size(); ++i)
+    if (s.live[i] == r) {
+      s.live[i] = s.live.back();
+      s.live.pop_back();
+      break;
+    }
+  s.free.push_back(r);
+}
+
+struct RingOwner {
+  Ring *ring = nullptr;
+  ~RingOwner() {
+    if (ring)
+      retire(ring);
+  }
+};
+
+Ring *thread_ring() {
+  thread_local RingOwner owner;
+  if (!owner.ring) {
+    Store &s = store();
+    std::lock_guard<std::mutex> lock(s.mu);
+    if (s.free.empty()) {
+      owner.ring = new Ring;
+    } else {
+      owner.ring = s.free.back();
+      s.free.pop_back();
+      owner.ring->head.store(0, std::memory_order_relaxed);
+    }
+    owner.ring->tid = (long)syscall(SYS_gettid);
+    s.live.push_back(owner.ring);
+  }
+  return owner.ring;
+}
+
+// Names are code literals; escape them anyway so the file always parses.
+void write_json_string(FILE *f, const char *s) {
+  fputc('"', f);
+  for (; *s; ++s) {
+    if (*s == '"' || *s == '\\')
+      fputc('\\', f);
+    if ((unsigned char)*s >= 0x20)
+      fputc(*s, f);
+  }
+  fputc('"', f);
+}
+
+} // namespace
+
+uint64_t TraceSpan::now() { return perf_now(); }
+
+void trace_init() {
+  const char *path = getenv(TRACE_ENV);
+  if (!path || !*path)
+    return;
+  g_path = path;
+  trace_on = true;
+}
+
+void trace_record(const char *name, uint64_t start, uint64_t end) {
+  Ring *r = thread_ring();
+  uint64_t h = r->head.load(std::memory_order_relaxed);
+  r->events[h % Ring::CAPACITY] = {name, start, end};
+  r->head.store(h + 1, std::memory_order_release);
+}
+
+// Spans still being written by other threads may be torn or missing;
+// that only affects the last few microseconds of the trace.
+void trace_flush() {
+  if (!trace_on)
+    return;
+  FILE *f = fopen(g_path.c_str(), "w");
+  if (!f)
+    return;
+  int pid = (int)getpid();
+  fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+  bool first = true;
+  auto put = [&](long tid, const Event &e) {
+    fprintf(f, "%s{\"ph\": \"X\", \"pid\": %d, \"tid\": %ld, \"name\": ",
+            first ? "" : ",\n", pid, tid);
+    write_json_string(f, e.name);
+    fprintf(f, ", \"ts\": %.3f, \"dur\": %.3f}", e.start / 1e3,
+            (e.end - e.start) / 1e3);
+    first = false;
+  };
+  Store &s = store();
+  std::lock_guard<std::mutex> lock(s.mu);
+  uint64_t from = s.retired_head > RETIRED_CAPACITY
+                      ? s.retired_head - RETIRED_CAPACITY
+                      : 0;
+  for (uint64_t i = from; i < s.retired_head; ++i) {
+    const Retired &r = s.retired[i % RETIRED_CAPACITY];
+    put(r.tid, r.e);
+  }
+  for (const Ring *r : s.live) {
+    uint64_t head = r->head.load(std::memory_order_acquire);
+    uint64_t from = head > Ring::CAPACITY ? head - Ring::CAPACITY : 0;
+    for (uint64_t i = from; i < head; ++i)
+      put(r->tid, r->events[i % Ring::CAPACITY]);
+  }
+  fprintf(f, "\n]}\n");
+  fclose(f);
+}
@@ -0,0 +1,42 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+
+// Opt-in span tracing. When TRACE_ENV names a file, TraceSpans are
+// recorded into a per-thread ring buffer (the oldest spans are overwritten
+// once it is full) and trace_flush() writes them there as Chrome trace
+// JSON, which Perfetto and chrome://tracing open. An exiting thread moves
+// its spans to a shared ring and leaves its buffer to the next thread, so
+// short-lived workers do not each keep one. Recording takes no locks;
+// when tracing is off a span costs one branch.
+
+extern bool trace_on;
+
+// Read TRACE_ENV. Call once at startup, before any thread is started.
+void trace_init();
+// Write the recorded spans out. Call once at exit.
+void trace_flush();
+
+void trace_record(const char *name, uint64_t start, uint64_t end);
+
+// Records the enclosing scope under name, which must be a string literal
+// or otherwise outlive the process.
+class TraceSpan {
+public:
+  explicit TraceSpan(const char *name)
+      : name_(name), start_(trace_on ? now() : 0) {}
+  ~TraceSpan() {
+    if (start_)
+      trace_record(name_, start_, now());
+  }
+  TraceSpan(const TraceSpan &) = delete;
+  TraceSpan &operator=(const TraceSpan &) = delete;
+
+private:
+  static uint64_t now();
+  const char *name_;
+  uint64_t start_;
+};
+
+#endif
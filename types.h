@@ -1,24 +1,84 @@
 #ifndef TYPES_H
 #define TYPES_H
 
+#include <ctime>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "intern.h"
+
+// A video as listed. Channel fields, shared by many videos, are interned;
+// the title and path are reference counted and go with the last video
+// holding them. Either way a field is one pointer, so a Video is a small
+// record that copies without allocating. Metadata is 0 when the listing
+// did not include it.
 struct Video {
-    std::string id, title, path, channel_url, channel_name;
+    VideoId id;
+    Text title, path;
+    Str channel_url, channel_name, channel_id;
+    uint32_t duration = 0;    // seconds
+    uint32_t upload_date = 0; // YYYYMMDD
+    uint64_t view_count = 0;
     bool operator==(const Video &v) const { return id == v.id; }
 };
 
+// A video list held as an immutable, reference-counted snapshot. Copies
+// share it, so views, caches and background work can hold the same
+// listing for the price of a pointer. edit() gives the list to change in
+// place, copying it first if anyone else still holds it, so no holder ever
+// sees another's changes.
+class VideoList {
+public:
+    VideoList() = default;
+    VideoList(std::vector<Video> videos)
+        : p_(std::make_shared<std::vector<Video>>(std::move(videos))) {}
+
+    const std::vector<Video> &get() const { return p_ ? *p_ : none(); }
+    operator const std::vector<Video> &() const { return get(); }
+    size_t size() const { return get().size(); }
+    bool empty() const { return get().empty(); }
+    const Video &operator[](size_t i) const { return (*p_)[i]; }
+    std::vector<Video>::const_iterator begin() const { return get().begin(); }
+    std::vector<Video>::const_iterator end() const { return get().end(); }
+
+    std::vector<Video> &edit() {
+        if (!p_)
+            p_ = std::make_shared<std::vector<Video>>();
+        else if (p_.use_count() > 1)
+            p_ = std::make_shared<std::vector<Video>>(*p_);
+        return *p_;
+    }
+    // True when both hold the very same snapshot.
+    bool shares(const VideoList &o) const { return p_ == o.p_; }
+
+private:
+    static const std::vector<Video> &none() {
+        static const std::vector<Video> empty;
+        return empty;
+    }
+    std::shared_ptr<std::vector<Video>> p_;
+};
+
 struct Channel {
     std::string name, url;
 };
 
+// When a channel's listing was last fetched successfully. Persisted as the
+// fetch time of its result cache record.
+struct ChannelState {
+    time_t fetched = 0;
+};
+
 struct Download {
     Video v;
     int pid;
     bool done;
 };
 
-enum Focus { HOME, DOWNLOADS, SUBSCRIPTIONS, CHANNEL, SEARCH, RESULTS };
+enum Focus { HOME, DOWNLOADS, SUBSCRIPTIONS, CHANNEL, SEARCH, RESULTS, FEED };
+
+// Display order of a video list, cycled with APP_KEY_SORT.
+enum SortOrder { SORT_LISTED, SORT_NEWEST, SORT_VIEWS, SORT_LONGEST };
 
 #endif
@@ -1,19 +1,29 @@
 #include "ui.h"
 
+#include "catalog.h"
 #include "config.h"
+#include "filter.h"
 #include "globals.h"
+#include "output.h"
+#include "perf.h"
+#include "tasks.h"
+#include "trace.h"
 #include "types.h"
 #include "utils.h"
 #include "youtube.h"
 
 #include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
 #include <ctime>
-#include <functional>
 #include <locale.h>
+#include <memory>
 #include <ncurses.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <unordered_map>
 
 namespace {
 
@@ -29,6 +39,8 @@ size_t &scroll_for_focus(Focus f) {
     return channel_scroll;
   case RESULTS:
     return results_scroll;
+  case FEED:
+    return feed_scroll;
   default: {
     static size_t dummy = 0;
     return dummy;
@@ -37,10 +49,218 @@ size_t &scroll_for_focus(Focus f) {
 }
 
 bool focus_has_video_content(Focus f) {
-  return f == HOME || f == DOWNLOADS || f == RESULTS || f == CHANNEL;
+  return f == HOME || f == DOWNLOADS || f == RESULTS || f == CHANNEL ||
+         f == FEED;
 }
 
-void render_status_bar(const std::vector<Video> *cached_downloads = nullptr) {
+// Identifies exactly what a list holds: a VideoList by its snapshot, kept
+// here so that any change to the list makes a different one, and History
+// by its version. Other lists are only ever empty placeholders.
+struct ListStamp {
+  VideoList snapshot;
+  const void *list = nullptr;
+  uint64_t version = 0;
+  bool operator==(const ListStamp &o) const {
+    return snapshot.shares(o.snapshot) && list == o.list &&
+           version == o.version;
+  }
+  bool operator!=(const ListStamp &o) const { return !(*this == o); }
+};
+
+ListStamp stamp_of(const VideoList &list) {
+  ListStamp stamp;
+  stamp.snapshot = list;
+  return stamp;
+}
+
+ListStamp stamp_of(const History &list) {
+  ListStamp stamp;
+  stamp.list = &list;
+  stamp.version = list.version();
+  return stamp;
+}
+
+ListStamp stamp_of(const std::vector<Video> &list) {
+  ListStamp stamp;
+  stamp.list = &list;
+  stamp.version = list.size();
+  return stamp;
+}
+
+// The entries to index, safe to hand to a worker.
+VideoList snapshot_of(const VideoList &list) { return list; }
+VideoList snapshot_of(const History &list) { return list.shared(); }
+VideoList snapshot_of(const std::vector<Video> &list) { return list; }
+
+// '/' filter over the focused list. Its index is built on a worker, started
+// by '/' or by the list changing under an active filter, and installed
+// from the UI queue. Until then queries keep running against the previous
+// index of that view, over the snapshot it was built from, so no frame
+// waits for a build.
+VideoFilter list_filter;
+VideoList filter_list;           // the entries list_filter indexes
+Focus filter_list_focus = HOME;  // the view filter_list was taken from
+ListStamp filter_stamp;          // the list last handed to a build
+unsigned filter_gen = 0;         // the build whose index is wanted
+size_t filter_match_count = 0;
+bool filter_capped = false;
+
+bool filter_applies() { return filter_focus == focus && !filter_query.empty(); }
+
+// The index stays, keyed on its list, for the next '/' on that list.
+void clear_filter() {
+  filter_editing = false;
+  filter_query.clear();
+}
+
+template <typename List> void prepare_filter(const List &list) {
+  ListStamp stamp = stamp_of(list);
+  if (stamp == filter_stamp)
+    return;
+  filter_stamp = stamp;
+  run_async([gen = ++filter_gen, from = focus, videos = snapshot_of(list)] {
+    TraceSpan span("filter index");
+    VideoFilter filter;
+    filter.build(videos);
+    post_main([gen, from, videos, filter = std::move(filter)]() mutable {
+      if (gen != filter_gen)
+        return;
+      list_filter = std::move(filter);
+      filter_list = videos;
+      filter_list_focus = from;
+    });
+  });
+}
+
+// Hits index filter_list, not list, which may have changed since.
+template <typename List>
+const std::vector<uint32_t> *filter_hits(const List &list) {
+  if (!filter_applies())
+    return nullptr;
+  prepare_filter(list);
+  static const std::vector<uint32_t> none;
+  const std::vector<uint32_t> *hits = &none;
+  if (filter_list_focus == focus && list_filter.built())
+    hits = &list_filter.match(filter_query);
+  filter_match_count = hits->size();
+  filter_capped = hits != &none && list_filter.capped();
+  return hits;
+}
+
+// 'o' sort over the focused list, applied after the filter. The order is
+// kept until the list, the filter or the sort changes.
+std::vector<uint32_t> sort_order;
+ListStamp sort_list;
+std::string sort_query;
+SortOrder sort_built = SORT_LISTED;
+
+bool sort_applies() { return sort_focus == focus && list_sort != SORT_LISTED; }
+
+const char *sort_name(SortOrder s) {
+  switch (s) {
+  case SORT_NEWEST:
+    return "newest";
+  case SORT_VIEWS:
+    return "most viewed";
+  case SORT_LONGEST:
+    return "longest";
+  default:
+    return "list order";
+  }
+}
+
+// Sorts hits, or all of list without them.
+template <typename List>
+const std::vector<uint32_t> *sort_view(const List &list,
+                                       const std::vector<uint32_t> *hits) {
+  ListStamp stamp = stamp_of(list);
+  std::string query = hits ? filter_query : std::string();
+  if (sort_built == list_sort && sort_list == stamp && sort_query == query)
+    return &sort_order;
+
+  if (hits) {
+    sort_order = *hits;
+  } else {
+    sort_order.resize(list.size());
+    for (uint32_t i = 0; i < sort_order.size(); ++i)
+      sort_order[i] = i;
+  }
+  // Keys are gathered in one sequential pass, since History only indexes
+  // cheaply in order.
+  std::vector<uint64_t> keys;
+  auto by = [&](auto key) {
+    keys.resize(list.size());
+    for (size_t i = 0; i < list.size(); ++i)
+      keys[i] = key(list[i]);
+    std::stable_sort(
+        sort_order.begin(), sort_order.end(),
+        [&](uint32_t a, uint32_t b) { return keys[a] > keys[b]; });
+  };
+  if (list_sort == SORT_NEWEST)
+    by([](const Video &v) { return v.upload_date; });
+  else if (list_sort == SORT_VIEWS)
+    by([](const Video &v) { return v.view_count; });
+  else if (list_sort == SORT_LONGEST)
+    by([](const Video &v) { return v.duration; });
+  sort_built = list_sort;
+  sort_list = stamp;
+  sort_query = query;
+  return &sort_order;
+}
+
+// A list as seen through the '/' filter and the 'o' sort; sel indexes
+// this view. While filtered, order indexes `filtered`, the snapshot the
+// filter index was built from, rather than base.
+template <typename List> struct ListView {
+  const List &base;
+  const std::vector<uint32_t> *order;
+  const VideoList *filtered;
+  size_t size() const { return order ? order->size() : base.size(); }
+  bool empty() const { return size() == 0; }
+  const Video &operator[](size_t i) const {
+    if (filtered)
+      return (*filtered)[(*order)[i]];
+    return base[order ? (*order)[i] : i];
+  }
+};
+
+template <typename List> ListView<List> view_of(const List &list) {
+  if (const std::vector<uint32_t> *hits = filter_hits(list)) {
+    bool sort = sort_applies() && !hits->empty();
+    return {list, sort ? sort_view(filter_list, hits) : hits, &filter_list};
+  }
+  return {list, sort_applies() ? sort_view(list, nullptr) : nullptr,
+          nullptr};
+}
+
+template <typename List>
+void preload_view(const ListView<List> &view, size_t start) {
+  if (!view.order) {
+    preload_thumbnails(view.base, start);
+    return;
+  }
+  std::vector<Video> next;
+  for (size_t i = start; i < view.size() && next.size() < 5; ++i)
+    next.push_back(view[i]);
+  preload_thumbnails(next, 0);
+}
+
+// The perf_report() table in a box over the bottom left of the view.
+void render_perf_overlay(int h, int w) {
+  std::vector<std::string> lines = perf_report();
+  size_t width = 0;
+  for (const auto &l : lines)
+    width = std::max(width, l.size());
+  width = std::min(width, (size_t)std::max(0, w - 4));
+  int top = std::max(1, h - 2 - (int)lines.size());
+  attron(A_REVERSE);
+  for (size_t i = 0; i < lines.size() && top + (int)i < h - 1; ++i)
+    mvprintw(top + (int)i, 1, " %-*.*s ", (int)width, (int)width,
+             lines[i].c_str());
+  attroff(A_REVERSE);
+}
+
+void render_status_bar() {
   int h, w;
   getmaxyx(stdscr, h, w);
   int y = h - 1;
@@ -48,23 +268,42 @@ void render_status_bar(const std::vector<Video> *cached_downloads = nullptr) {
   move(y, 0);
   clrtoeol();
 
+  int left_x = 1;
+  if (filter_focus == focus && (filter_editing || !filter_query.empty())) {
+    std::string prompt = "/" + filter_query;
+    if (filter_editing)
+      prompt += '_';
+    if (!filter_query.empty())
+      prompt += "  [" + std::to_string(filter_match_count) +
+                (filter_capped ? "+]" : "]");
+    attron(filter_editing ? (COLOR_PAIR(1) | A_BOLD) : A_BOLD);
+    mvprintw(y, left_x, "%s", prompt.c_str());
+    attroff(COLOR_PAIR(1) | A_BOLD);
+    left_x += (int)prompt.size() + 2;
+  }
+  if (sort_applies()) {
+    attron(A_DIM);
+    mvprintw(y, left_x, "sort: %s", sort_name(list_sort));
+    attroff(A_DIM);
+  }
+
   if (time(nullptr) - status_time < 3 && !status_msg.empty()) {
     attron(A_BOLD);
-    int start = w - (int)status_msg.length() - 2;
-    if (start < 2)
-      start = 2;
-    mvprintw(y, start, "%s", status_msg.c_str());
+    std::string msg = clip_text(status_msg, std::max(0, w - 4));
+    int start = std::max(2, w - text_width(msg) - 2);
+    mvaddstr(y, start, msg.c_str());
     attroff(A_BOLD);
+  } else if (state_loading()) {
+    const char *loading = "Loading...";
+    attron(A_DIM);
+    mvprintw(y, std::max(2, w - (int)strlen(loading) - 2), "%s", loading);
+    attroff(A_DIM);
   }
 
   int info_x = w / 2;
   std::string info;
   if (focus == DOWNLOADS) {
-    int total = 0, active = 0;
-    if (cached_downloads)
-      total = static_cast<int>(cached_downloads->size());
-    else
-      total = static_cast<int>(scan_video_cache().size());
+    int total = static_cast<int>(catalog_videos().size()), active = 0;
     for (const auto &d : downloads)
       if (d.pid > 0)
         active++;
@@ -72,6 +311,17 @@ void render_status_bar(const std::vector<Video> *cached_downloads = nullptr) {
     if (active > 0)
       info += " | " + std::to_string(active) + " active";
   }
+  if (page_loading()) {
+    if (!info.empty())
+      info += " | ";
+    info += "loading more...";
+  }
+  if (subs_refresh_total > 0) {
+    if (!info.empty())
+      info += " | ";
+    info += "subs " + std::to_string(subs_refresh_done) + "/" +
+            std::to_string(subs_refresh_total);
+  }
   if (!info.empty()) {
     attron(A_DIM);
     mvprintw(y, info_x, "%s", info.c_str());
@@ -85,8 +335,63 @@ void remember_channel_origin(Focus target, size_t selection) {
   channel_return_active = true;
 }
 
+// A list row laid out for one content width: "o  12. " or "*  12. ", the
+// title clipped to the room left, and the metadata shown right-aligned
+// when the title keeps enough room next to it. `v` is the video it was
+// laid out from.
+struct RowLayout {
+  Video v;
+  std::string head, title, meta;
+  int meta_x = 0;
+};
+
+// Rows by view index. A row is laid out again when another video lands on
+// its index, or the same one with other metadata or another title, as
+// after a refresh. Titles compare by identity, and each fetch makes new
+// ones, so refetched rows are laid out again. Everything is when the width
+// (terminal size, thumbnail pane) or the catalog (file markers and sizes)
+// changes.
+std::unordered_map<size_t, RowLayout> row_layouts;
+int row_layout_width = -1;
+VideoList row_layout_catalog;
+
+const RowLayout &row_layout(size_t idx, const Video &v, int content_w) {
+  const VideoList &catalog = catalog_videos();
+  if (content_w != row_layout_width || !row_layout_catalog.shares(catalog) ||
+      row_layouts.size() > 4096) {
+    row_layouts.clear();
+    row_layout_width = content_w;
+    row_layout_catalog = catalog;
+  }
+  RowLayout &row = row_layouts[idx];
+  if (!row.head.empty() && row.v.id == v.id && row.v.title.same(v.title) &&
+      row.v.duration == v.duration && row.v.view_count == v.view_count &&
+      row.v.upload_date == v.upload_date)
+    return row;
+
+  const CatalogEntry *file = catalog_find(v.id);
+  row.v = v;
+  row.head = std::string(file ? "* " : "o ") + " " + std::to_string(idx + 1) +
+             ". ";
+  int max_w = content_w - (int)row.head.size() - 2;
+  row.meta = video_meta(v);
+  if (file && file->size > 0)
+    row.meta =
+        file_size(file->size) + (row.meta.empty() ? "" : "  ") + row.meta;
+  int meta_w = text_width(row.meta);
+  if (!row.meta.empty() && max_w - meta_w - 2 >= 20) {
+    max_w -= meta_w + 2;
+    row.meta_x = content_w - 3 - meta_w;
+  } else {
+    row.meta.clear();
+  }
+  row.title = clip_text(v.title.view(), max_w);
+  return row;
+}
+
+template <typename List>
 void render_video_list_section(int y, int h, const std::string &title,
-                               const std::vector<Video> &items, bool active,
+                               const List &items, bool active,
                                size_t &offset) {
   int w = getmaxx(stdscr);
   // Mirror thumb_geometry: thumb occupies right (w*35/100) cols
@@ -146,15 +451,14 @@ void render_video_list_section(int y, int h, const std::string &title,
     if (selected)
       attron(A_REVERSE | A_BOLD);
 
-    std::string prefix = is_video_downloaded(items[idx]) ? "* " : "o ";
-    std::string num = std::to_string(idx + 1) + ". ";
-    mvprintw(y + 1 + i, 2, "%s %s", prefix.c_str(), num.c_str());
-
-    int max_w = content_w - (int)(prefix.length() + num.length()) - 3;
-    std::string disp_title = items[idx].title;
-    if ((int)disp_title.length() > max_w)
-      disp_title = disp_title.substr(0, max_w - 3) + "...";
-    printw("%s", disp_title.c_str());
+    const RowLayout &row = row_layout(idx, items[idx], content_w);
+    mvaddstr(y + 1 + (int)i, 2, row.head.c_str());
+    addstr(row.title.c_str());
+    if (!row.meta.empty()) {
+      attron(A_DIM);
+      mvaddstr(y + 1 + (int)i, row.meta_x, row.meta.c_str());
+      attroff(A_DIM);
+    }
 
     if (selected)
       attroff(A_REVERSE | A_BOLD);
@@ -203,8 +507,9 @@ void render_search_view() {
   mvprintw(header_y, header_x, "%s", header.c_str());
   attroff(A_BOLD | COLOR_PAIR(1));
 
-  std::string help = insert_mode ? "Enter search  Esc normal  Left/Right move"
-                                 : "Enter edit  Esc normal  j/k navigate";
+  std::string help = insert_mode
+                         ? "Enter search  Esc normal  Tab/Right complete"
+                         : "Enter edit  Esc normal  j/k navigate";
   if ((int)help.size() > w - left - 1)
     help.resize(std::max(0, w - left - 1));
   int help_y = std::min(bottom + 1, h - 2);
@@ -285,6 +590,22 @@ void render_search_view() {
       attroff(A_REVERSE);
   }
 
+  // Inline completion, dimmed after the typed text, when the caret is at
+  // the end and the whole query is visible.
+  if (insert_mode && caret == query.size() && window_start == 0) {
+    const std::string *completion = search_completer.complete(query);
+    int gx = text_start + (int)query.size();
+    int room = right - gx;
+    if (completion && room > 0) {
+      std::string ghost = completion->substr(query.size());
+      if ((int)ghost.size() > room)
+        ghost.resize(room);
+      attron(A_DIM);
+      mvprintw(top + 1, gx, "%s", ghost.c_str());
+      attroff(A_DIM);
+    }
+  }
+
   int cx = text_start + (int)(caret - window_start);
   cx = std::max(text_start, std::min(cx, right - 2));
   if (insert_mode) {
@@ -317,8 +638,7 @@ void render_search_view() {
 }
 
 void render_subscriptions_view(int h, int w) {
-  if (subs.empty())
-    load_subs();
+  ensure_subs();
 
   std::string logo = "-=YTUI=-";
   attron(COLOR_PAIR(1) | A_BOLD);
@@ -364,9 +684,8 @@ void render_subscriptions_view(int h, int w) {
     if (selch)
       attron(A_REVERSE | A_BOLD);
 
-    std::string name = subs[idx].name.empty() ? subs[idx].url : subs[idx].name;
-    if ((int)name.size() > w - 10)
-      name = name.substr(0, w - 13) + "...";
+    std::string name = clip_text(
+        subs[idx].name.empty() ? subs[idx].url : subs[idx].name, w - 10);
 
     const bool is_active_channel = (subs_channel_idx == (int)idx);
     const char marker = is_active_channel ? '>' : ' ';
@@ -398,19 +717,19 @@ void enter_subscription_channel(size_t index) {
     subs_cache.resize(index + 1);
   auto &cache = subs_cache[index];
   if (cache.empty()) {
-    cache = fetch_videos(subs[index].url, MAX_LIST_ITEMS);
+    cache = load_channel_videos(subs[index].url);
   }
 
   const std::string &url = subs[index].url;
-  const std::vector<Video> *prefetched = cache.empty() ? nullptr : &cache;
+  const VideoList *prefetched = cache.empty() ? nullptr : &cache;
   enter_channel_view(url, prefetched);
 }
 
 } // namespace
 
-void init_ui() {
-  setlocale(LC_ALL, "");
-  initscr();
+namespace {
+
+void setup_screen() {
   start_color();
   use_default_colors();
   init_pair(1, COLOR_CYAN, -1);
@@ -424,27 +743,36 @@ void init_ui() {
   curs_set(1);
 }
 
-void cleanup_ui() { endwin(); }
+} // namespace
+
+void init_ui() {
+  setlocale(LC_ALL, "");
+  output_init();
+  setup_screen();
+  probe_cell_size();
+}
+
+void init_ui_headless(FILE *out) {
+  setlocale(LC_ALL, "");
+  output_init_headless(out);
+  setup_screen();
+}
+
+void cleanup_ui() { output_end(); }
 
 void draw() {
+  PerfScope timer(PERF_DRAW);
+  TraceSpan span("draw");
   erase(); // erase() redraws ncurses without sending a terminal clear,
            // so kitty retains the uploaded image in memory across frames.
   int h, w;
   getmaxyx(stdscr, h, w);
 
-  bool cache_initialized = false;
-  std::vector<Video> cached_videos;
-  auto ensure_cache = [&]() -> const std::vector<Video> & {
-    if (!cache_initialized) {
-      cached_videos = scan_video_cache();
-      cache_initialized = true;
-    }
-    return cached_videos;
-  };
+  catalog_sync();
 
   switch (focus) {
   case HOME: {
-    render_video_list_section(1, h - 2, "HISTORY", history, true,
+    render_video_list_section(1, h - 2, "HISTORY", view_of(history), true,
                               history_scroll);
     break;
   }
@@ -452,9 +780,8 @@ void draw() {
     render_search_view();
     break;
   case DOWNLOADS: {
-    const auto &cache = ensure_cache();
-    auto items = collect_download_items(cache);
-    render_video_list_section(1, h - 2, "DOWNLOADS", items, true,
+    auto items = collect_download_items();
+    render_video_list_section(1, h - 2, "DOWNLOADS", view_of(items), true,
                               downloads_scroll);
     break;
   }
@@ -462,483 +789,571 @@ void draw() {
     render_subscriptions_view(h, w);
     break;
   case RESULTS:
-    render_video_list_section(1, h - 2, "RESULTS", res, true, results_scroll);
+    render_video_list_section(1, h - 2, "RESULTS", view_of(res), true,
+                              results_scroll);
+    break;
+  case FEED:
+    render_video_list_section(1, h - 2, "NEW VIDEOS", view_of(feed_videos),
+                              true, feed_scroll);
     break;
   case CHANNEL: {
-    render_video_list_section(1, h - 2, "CHANNEL", channel_videos, true,
-                              channel_scroll);
+    render_video_list_section(1, h - 2, "CHANNEL", view_of(channel_videos),
+                              true, channel_scroll);
     break;
   }
   }
 
-  const std::vector<Video> *status_cache = nullptr;
-  if (!downloads.empty()) {
-    const auto &cache = ensure_cache();
-    update_download_statuses(cache);
-    if (focus == DOWNLOADS)
-      status_cache = &cache;
-  } else if (focus == DOWNLOADS) {
-    const auto &cache = ensure_cache();
-    status_cache = &cache;
-  }
+  if (!downloads.empty())
+    update_download_statuses();
 
-  render_status_bar(status_cache);
+  render_status_bar();
+  if (perf_overlay)
+    render_perf_overlay(h, w);
 
-  refresh();
+  wnoutrefresh(stdscr); // sent by output_present()
 }
 
-bool handle_input() {
-  int ch = getch();
-  if (ch == ERR)
-    return true;
-
-  if (ch == APP_KEY_QUIT)
-    return false;
-
-  auto reset_search_state = [&]() {
-    insert_mode = false;
-    search_hist_idx = -1;
-    query_pos = query.size();
-    curs_set(0);
-  };
+namespace {
 
-  auto set_focus = [&](Focus target) {
-    focus = target;
-    sel = 0;
-    channel_return_active = false;
-    if (target != CHANNEL)
-      subs_channel_idx = -1;
-    scroll_for_focus(target) = 0;
-    reset_search_state();
-    if (!focus_has_video_content(target))
-      hide_thumbnail();
-  };
+// What a key does. Each focus has a table from key to action, built once,
+// so a key costs a lookup instead of a chain of tests.
+enum Action : uint8_t {
+  ACT_NONE,
+  ACT_QUIT,
+  ACT_PERF,
+  ACT_DOWN,
+  ACT_UP,
+  ACT_BACK,
+  ACT_SELECT,
+  ACT_DOWNLOAD,
+  ACT_CHANNEL,
+  ACT_SUB_TOGGLE,
+  ACT_REFRESH,
+  ACT_REFRESH_ALL,
+  ACT_GO_HOME,
+  ACT_GO_SEARCH,
+  ACT_GO_DOWNLOADS,
+  ACT_GO_SUBS,
+  ACT_GO_FEED,
+  ACT_SORT,
+  ACT_FILTER,
+  // Search view
+  ACT_TAB,
+  ACT_ESCAPE,
+  ACT_LEFT,
+  ACT_RIGHT,
+  ACT_ERASE,
+  ACT_DELETE,
+  ACT_TYPE,
+  // '/' prompt
+  ACT_FILTER_CANCEL,
+  ACT_FILTER_DONE,
+  ACT_FILTER_ERASE,
+  ACT_FILTER_TYPE,
+};
+
+using KeyMap = std::array<Action, KEY_MAX + 1>;
+
+// A map per Focus, then one for typing a query and one for the '/' prompt,
+// which only takes the keys it knows and leaves the rest to the focus.
+enum { MAP_SEARCH_INSERT = FEED + 1, MAP_FILTER, MAP_COUNT };
+
+void bind(KeyMap &map, std::initializer_list<int> keys, Action action) {
+  for (int k : keys)
+    map[k] = action;
+}
 
-  bool cached_files_initialized = false;
-  std::vector<Video> cached_files;
-  auto ensure_cached_files = [&]() -> const std::vector<Video> & {
-    if (!cached_files_initialized) {
-      cached_files = scan_video_cache();
-      cached_files_initialized = true;
+std::array<KeyMap, MAP_COUNT> build_key_maps() {
+  std::array<KeyMap, MAP_COUNT> maps{};
+  for (int f = HOME; f <= FEED; ++f) {
+    KeyMap &map = maps[f];
+    bind(map, {APP_KEY_QUIT}, ACT_QUIT);
+    bind(map, {APP_KEY_PERF}, ACT_PERF);
+    bind(map, {KEY_DOWN, 'j', 'J'}, ACT_DOWN);
+    bind(map, {KEY_UP, 'k', 'K'}, ACT_UP);
+    bind(map, {'h', 'H'}, ACT_BACK);
+    bind(map, {'\n', '\r', 'l', 'L'}, ACT_SELECT);
+    bind(map, {APP_KEY_HOME}, ACT_GO_HOME);
+    bind(map, {APP_KEY_SEARCH}, ACT_GO_SEARCH);
+    bind(map, {APP_KEY_DOWNLOADS}, ACT_GO_DOWNLOADS);
+    bind(map, {APP_KEY_SUBS}, ACT_GO_SUBS);
+    bind(map, {APP_KEY_FEED}, ACT_GO_FEED);
+    if (f != SEARCH) {
+      bind(map, {APP_KEY_CHANNEL}, ACT_CHANNEL);
+      bind(map, {APP_KEY_SUB_TOGGLE}, ACT_SUB_TOGGLE);
     }
-    return cached_files;
-  };
-
-  bool download_items_initialized = false;
-  std::vector<Video> download_items_cache;
-  auto ensure_download_items = [&]() -> const std::vector<Video> & {
-    if (!download_items_initialized) {
-      download_items_cache = collect_download_items(ensure_cached_files());
-      download_items_initialized = true;
+    if (focus_has_video_content((Focus)f)) {
+      bind(map, {APP_KEY_DOWNLOAD}, ACT_DOWNLOAD);
+      bind(map, {APP_KEY_SORT}, ACT_SORT);
+      bind(map, {APP_KEY_FILTER}, ACT_FILTER);
     }
-    return download_items_cache;
-  };
+  }
+  bind(maps[SUBSCRIPTIONS], {'r'}, ACT_REFRESH);
+  bind(maps[SUBSCRIPTIONS], {APP_KEY_REFRESH_ALL}, ACT_REFRESH_ALL);
+  bind(maps[FEED], {APP_KEY_REFRESH_ALL}, ACT_REFRESH_ALL);
+  bind(maps[CHANNEL], {'r'}, ACT_REFRESH);
+  bind(maps[CHANNEL], {27}, ACT_BACK);
+  bind(maps[SEARCH], {'\t'}, ACT_TAB);
+
+  KeyMap &insert = maps[MAP_SEARCH_INSERT];
+  for (int c = 32; c <= 126; ++c)
+    insert[c] = ACT_TYPE;
+  bind(insert, {APP_KEY_QUIT}, ACT_QUIT);
+  bind(insert, {'\n', '\r'}, ACT_SELECT);
+  bind(insert, {'\t'}, ACT_TAB);
+  bind(insert, {27}, ACT_ESCAPE);
+  bind(insert, {KEY_LEFT}, ACT_LEFT);
+  bind(insert, {KEY_RIGHT}, ACT_RIGHT);
+  bind(insert, {KEY_BACKSPACE, 127, 8}, ACT_ERASE);
+  bind(insert, {KEY_DC}, ACT_DELETE);
+
+  KeyMap &filter = maps[MAP_FILTER];
+  for (int c = 32; c <= 126; ++c)
+    filter[c] = ACT_FILTER_TYPE;
+  bind(filter, {27}, ACT_FILTER_CANCEL);
+  bind(filter, {'\n', '\r'}, ACT_FILTER_DONE);
+  bind(filter, {KEY_BACKSPACE, 127, 8}, ACT_FILTER_ERASE);
+  return maps;
+}
 
-  auto refresh_thumbnail = [&]() {
-    if (focus == HOME) {
-      if (history.empty()) {
-        hide_thumbnail();
-        return;
-      }
-      if (sel >= history.size())
-        sel = history.size() - 1;
-      show_thumbnail(history[sel]);
-      preload_thumbnails(history, sel + 1);
-      return;
-    }
-    if (focus == DOWNLOADS) {
-      const auto &items = ensure_download_items();
-      if (items.empty()) {
-        hide_thumbnail();
-        return;
-      }
-      if (sel >= items.size())
-        sel = items.size() - 1;
-      show_thumbnail(items[sel]);
-      preload_thumbnails(items, sel + 1);
-      return;
-    }
-    if (focus == RESULTS) {
-      if (res.empty()) {
-        hide_thumbnail();
-        return;
-      }
-      if (sel >= res.size())
-        sel = res.size() - 1;
-      show_thumbnail(res[sel]);
-      preload_thumbnails(res, sel + 1);
-      return;
-    }
-    if (focus == CHANNEL) {
-      if (channel_videos.empty()) {
-        hide_thumbnail();
-        return;
-      }
-      if (sel >= channel_videos.size())
-        sel = channel_videos.size() - 1;
-      show_thumbnail(channel_videos[sel]);
-      preload_thumbnails(channel_videos, sel + 1);
-      return;
-    }
-    hide_thumbnail();
-  };
+Action key_action(int ch) {
+  static const std::array<KeyMap, MAP_COUNT> maps = build_key_maps();
+  if (ch < 0 || ch > KEY_MAX)
+    return ACT_NONE;
+  if (filter_focus == focus) {
+    if (filter_editing && maps[MAP_FILTER][ch] != ACT_NONE)
+      return maps[MAP_FILTER][ch];
+    if (!filter_editing && ch == 27 && !filter_query.empty())
+      return ACT_FILTER_CANCEL;
+  }
+  return maps[focus == SEARCH && insert_mode ? (int)MAP_SEARCH_INSERT
+                                             : (int)focus][ch];
+}
 
-  const bool search_insert = (focus == SEARCH && insert_mode);
-  const bool allow_vim_nav = !search_insert;
+// Set when the focus, the list or the selection changed. The thumbnail,
+// the prefetches and the next page follow once the keys of the frame are
+// handled, rather than for every step on the way.
+bool selection_moved = false;
 
-  const bool navDown =
-      (ch == KEY_DOWN) || (allow_vim_nav && (ch == 'j' || ch == 'J'));
-  const bool navUp =
-      (ch == KEY_UP) || (allow_vim_nav && (ch == 'k' || ch == 'K'));
-  const bool navBack = allow_vim_nav && (ch == 'h' || ch == 'H');
-  const bool navSelect =
-      (ch == '\n' || ch == '\r') || (allow_vim_nav && (ch == 'l' || ch == 'L'));
+void reset_search_state() {
+  insert_mode = false;
+  search_hist_idx = -1;
+  query_pos = query.size();
+  curs_set(0);
+}
 
-  auto move_selection = [&](size_t size) {
-    if (size == 0) {
-      sel = 0;
-      return false;
-    }
-    if (sel >= size)
-      sel = size - 1;
-    if (navDown && sel + 1 < size) {
-      ++sel;
-      return true;
-    }
-    if (navUp && sel > 0) {
-      --sel;
-      return true;
-    }
-    return false;
-  };
+void set_focus(Focus target) {
+  focus = target;
+  sel = 0;
+  channel_return_active = false;
+  if (target != CHANNEL)
+    subs_channel_idx = -1;
+  scroll_for_focus(target) = 0;
+  reset_search_state();
+  clear_filter();
+  list_sort = SORT_LISTED;
+  selection_moved = true;
+}
 
-  auto handle_list_navigation = [&](size_t size,
-                                    const std::function<void()> &onBack,
-                                    const std::function<void()> &onSelect) {
-    if (move_selection(size))
-      return true;
-    if (navBack && onBack) {
-      onBack();
-      return true;
-    }
-    if (navSelect && onSelect && size > 0 && sel < size) {
-      onSelect();
-      return true;
-    }
-    return false;
-  };
+// Calls fn with the focused video list as seen through the '/' filter.
+template <typename Fn> auto with_focused_list(Fn &&fn) {
+  static const std::vector<Video> none;
+  switch (focus) {
+  case HOME:
+    return fn(view_of(history));
+  case DOWNLOADS:
+    return fn(view_of(collect_download_items()));
+  case RESULTS:
+    return fn(view_of(res));
+  case CHANNEL:
+    return fn(view_of(channel_videos));
+  case FEED:
+    return fn(view_of(feed_videos));
+  default:
+    return fn(view_of(none));
+  }
+}
 
-  auto handle_video_list =
-      [&](const std::vector<Video> &list, const std::function<void()> &onBack,
-          const std::function<void()> &onSelect,
-          const std::function<void()> &onDownload = std::function<void()>()) {
-        if (move_selection(list.size())) {
-          if (!list.empty() && sel < list.size()) {
-            show_thumbnail(list[sel]);
-            preload_thumbnails(list, sel + 1);
-          } else {
-            hide_thumbnail();
-          }
-          return true;
-        }
-        if (navBack && onBack) {
-          onBack();
-          return true;
-        }
-        if (navSelect && onSelect && !list.empty() && sel < list.size()) {
-          onSelect();
-          return true;
-        }
-        if (ch == APP_KEY_DOWNLOAD && sel < list.size()) {
-          if (onDownload)
-            onDownload();
-          else
-            enqueue_download(list[sel]);
-          return true;
-        }
-        return false;
-      };
-
-  if (focus != SEARCH) {
-    if (ch == APP_KEY_CHANNEL) {
-      if (focus == RESULTS && sel < res.size()) {
-        remember_channel_origin(RESULTS, sel);
-        show_channel_for(res[sel]);
-      } else if (focus == DOWNLOADS) {
-        const auto &items = ensure_download_items();
-        if (sel < items.size()) {
-          remember_channel_origin(DOWNLOADS, sel);
-          show_channel_for(items[sel]);
-        }
-      }
-      return true;
+void refresh_thumbnail() {
+  with_focused_list([](const auto &view) {
+    if (view.empty()) {
+      hide_thumbnail();
+      return;
     }
+    if (sel >= view.size())
+      sel = view.size() - 1;
+    show_thumbnail(view[sel]);
+    preload_view(view, sel + 1);
+  });
+  maybe_load_next_page();
+}
 
-    if (ch == APP_KEY_SUB_TOGGLE) {
-      const Video *v = nullptr;
-      if (focus == RESULTS && sel < res.size())
-        v = &res[sel];
-      else if (focus == HOME && sel < history.size())
-        v = &history[sel];
-      else if (focus == CHANNEL && sel < channel_videos.size())
-        v = &channel_videos[sel];
-      else if (focus == DOWNLOADS) {
-        const auto &items = ensure_download_items();
-        if (sel < items.size())
-          v = &items[sel];
-      }
-      if (v)
-        toggle_subscription(*v);
-      return true;
+// Applies a run of Up and Down keys, as key repeat or a paste delivers
+// them, as one change of the selection.
+void move_selection(const int *keys, size_t n) {
+  size_t size = focus == SUBSCRIPTIONS
+                    ? subs.size()
+                    : with_focused_list([](const auto &v) { return v.size(); });
+  if (size == 0) {
+    sel = 0;
+    return;
+  }
+  size_t at = std::min(sel, size - 1);
+  for (size_t i = 0; i < n; ++i) {
+    if (key_action(keys[i]) == ACT_DOWN) {
+      if (at + 1 < size)
+        ++at;
+    } else if (at > 0) {
+      --at;
     }
+  }
+  if (at != sel && focus != SUBSCRIPTIONS)
+    selection_moved = true;
+  sel = at;
+}
 
-    if (ch == 'r') {
-      if (focus == SUBSCRIPTIONS && sel < subs.size()) {
-        size_t idx = sel;
-        if (subs_cache.size() <= idx)
-          subs_cache.resize(idx + 1);
-        subs_cache[idx] = fetch_videos(subs[idx].url, MAX_LIST_ITEMS);
-        std::string name =
-            subs[idx].name.empty() ? subs[idx].url : subs[idx].name;
-        set_status("Prefetched channel: " + name);
-        return true;
-      }
-      if (focus == CHANNEL && !channel_url.empty()) {
-        channel_videos = fetch_videos(channel_url, MAX_LIST_ITEMS);
-        sel = 0;
-        if (subs_channel_idx >= 0) {
-          if (subs_cache.size() <= (size_t)subs_channel_idx)
-            subs_cache.resize(subs_channel_idx + 1);
-          subs_cache[subs_channel_idx] = channel_videos;
-        }
-        if (channel_videos.empty())
-          set_status("No videos found for channel");
-        else
-          set_status("Refreshed channel");
-        return true;
-      }
-    }
+void restore_channel_origin() {
+  reset_search_state();
+  Focus target = channel_return_active ? channel_return_focus : SUBSCRIPTIONS;
+  size_t selection =
+      channel_return_active
+          ? channel_return_sel
+          : (subs_channel_idx >= 0 ? (size_t)subs_channel_idx : 0);
+  channel_return_active = false;
+  auto clamp = [&](size_t sz) {
+    return sz == 0 ? (size_t)0 : std::min(selection, sz - 1);
+  };
+  subs_channel_idx = -1;
+  focus = target;
+  switch (target) {
+  case SUBSCRIPTIONS:
+    sel = clamp(subs.size());
+    break;
+  case RESULTS:
+    sel = clamp(res.size());
+    break;
+  case FEED:
+    sel = clamp(feed_videos.size());
+    break;
+  case DOWNLOADS:
+    sel = clamp(collect_download_items().size());
+    break;
+  case HOME:
+  case SEARCH:
+    sel = 0;
+    break;
+  default:
+    sel = selection;
+    break;
   }
+  scroll_for_focus(focus) = 0;
+  selection_moved = true;
+}
 
-  if (!search_insert) {
-    if (ch == APP_KEY_SUBS) {
-      set_focus(SUBSCRIPTIONS);
-      return true;
-    }
-    if (ch == APP_KEY_DOWNLOADS) {
-      set_focus(DOWNLOADS);
-      refresh_thumbnail();
-      return true;
-    }
-    if (ch == APP_KEY_HOME) {
+void go_back() {
+  switch (focus) {
+  case SUBSCRIPTIONS:
+    if (!subs.empty())
       set_focus(HOME);
-      refresh_thumbnail();
-      return true;
-    }
-    if (ch == APP_KEY_SEARCH) {
-      set_focus(SEARCH);
-      return true;
-    }
+    break;
+  case CHANNEL:
+    restore_channel_origin();
+    break;
+  case RESULTS:
+    set_focus(SEARCH);
+    break;
+  case FEED:
+    set_focus(SUBSCRIPTIONS);
+    break;
+  case DOWNLOADS:
+    set_focus(HOME);
+    break;
+  default:
+    break;
   }
+}
 
-  if (focus == SEARCH) {
-    if (ch == '\t') {
-      insert_mode = !insert_mode;
-      query_pos = query.size();
-      if (insert_mode) {
-        search_hist_idx = -1;
-        curs_set(1);
-      } else {
-        search_hist_idx = -1;
-        curs_set(0);
-      }
-      return true;
+void refresh_channel() {
+  if (focus == SUBSCRIPTIONS && sel < subs.size()) {
+    size_t idx = sel;
+    if (subs_cache.size() <= idx)
+      subs_cache.resize(idx + 1);
+    size_t added =
+        refresh_channel_videos(subs[idx].url, subs_cache[idx], false);
+    std::string name = subs[idx].name.empty() ? subs[idx].url : subs[idx].name;
+    set_status("Prefetched channel: " + name + " (" + std::to_string(added) +
+               " new)");
+  } else if (focus == CHANNEL && !channel_url.empty()) {
+    size_t added = refresh_channel_videos(channel_url, channel_videos, true);
+    if (subs_channel_idx >= 0) {
+      if (subs_cache.size() <= (size_t)subs_channel_idx)
+        subs_cache.resize(subs_channel_idx + 1);
+      subs_cache[subs_channel_idx] = channel_videos;
     }
+    if (channel_videos.empty())
+      set_status("No videos found for channel");
+    else if (added == 0)
+      set_status("Channel is up to date");
+    else
+      set_status("Refreshed channel: " + std::to_string(added) + " new");
+  }
+}
 
-    if (ch == 27 && insert_mode) {
-      insert_mode = false;
+void start_search(const std::string &q) {
+  run_search(q);
+  add_search_hist(q);
+  set_focus(RESULTS);
+}
+
+// Tab, or Right at the end of the query, accepts the inline completion.
+bool accept_completion() {
+  if (!insert_mode || query_pos < query.size())
+    return false;
+  const std::string *completion = search_completer.complete(query);
+  if (!completion)
+    return false;
+  query = *completion;
+  query_pos = query.size();
+  return true;
+}
+
+void search_key(Action action, int ch) {
+  switch (action) {
+  case ACT_TAB:
+    if (accept_completion())
+      break;
+    insert_mode = !insert_mode;
+    query_pos = query.size();
+    search_hist_idx = -1;
+    curs_set(insert_mode ? 1 : 0);
+    break;
+  case ACT_ESCAPE:
+    reset_search_state();
+    break;
+  case ACT_DOWN:
+    if (search_hist_idx < 0 && !search_hist.empty())
+      search_hist_idx = 0;
+    else if (search_hist_idx >= 0 &&
+             search_hist_idx + 1 < (int)search_hist.size())
+      ++search_hist_idx;
+    break;
+  case ACT_UP:
+    if (search_hist_idx > 0)
+      --search_hist_idx;
+    else if (search_hist_idx == 0)
+      search_hist_idx = -1;
+    else if (search_hist_idx < 0 && !search_hist.empty())
+      search_hist_idx = (int)search_hist.size() - 1;
+    break;
+  case ACT_SELECT:
+    if (insert_mode) {
+      if (!query.empty())
+        start_search(query);
+      else
+        reset_search_state();
+    } else if (search_hist_idx >= 0 &&
+               search_hist_idx < (int)search_hist.size()) {
+      query = search_hist[search_hist_idx];
+      if (!query.empty())
+        start_search(query);
+    } else {
+      insert_mode = true;
       search_hist_idx = -1;
       query_pos = query.size();
-      curs_set(0);
-      return true;
+      curs_set(1);
     }
-
-    if (!insert_mode) {
-      if (navDown) {
-        if (search_hist_idx < 0 && !search_hist.empty())
-          search_hist_idx = 0;
-        else if (search_hist_idx >= 0 &&
-                 search_hist_idx + 1 < (int)search_hist.size())
-          ++search_hist_idx;
-        return true;
-      }
-      if (navUp) {
-        if (search_hist_idx > 0)
-          --search_hist_idx;
-        else if (search_hist_idx == 0)
-          search_hist_idx = -1;
-        else if (search_hist_idx < 0 && !search_hist.empty())
-          search_hist_idx = (int)search_hist.size() - 1;
-        return true;
-      }
-      if (navSelect) {
-        if (search_hist_idx >= 0 && search_hist_idx < (int)search_hist.size()) {
-          query = search_hist[search_hist_idx];
-          if (!query.empty()) {
-            res = fetch_videos(query, MAX_LIST_ITEMS);
-            add_search_hist(query);
-            set_focus(RESULTS);
-            refresh_thumbnail();
-          }
-        } else {
-          insert_mode = true;
-          search_hist_idx = -1;
-          query_pos = query.size();
-          curs_set(1);
-        }
-        return true;
-      }
-    } else {
-      if (navSelect) {
-        if (!query.empty()) {
-          res = fetch_videos(query, MAX_LIST_ITEMS);
-          add_search_hist(query);
-          set_focus(RESULTS);
-          refresh_thumbnail();
-        } else {
-          insert_mode = false;
-          search_hist_idx = -1;
-          query_pos = query.size();
-          curs_set(0);
-        }
-        return true;
-      }
-      if (ch == KEY_LEFT) {
-        if (query_pos > 0)
-          --query_pos;
-        return true;
-      }
-      if (ch == KEY_RIGHT) {
-        if (query_pos < query.size())
-          ++query_pos;
-        return true;
-      }
-      if (ch == KEY_BACKSPACE || ch == 127 || ch == 8) {
-        if (query_pos > 0) {
-          query.erase(query_pos - 1, 1);
-          --query_pos;
-        }
-        return true;
-      }
-      if (ch == KEY_DC) {
-        if (query_pos < query.size())
-          query.erase(query_pos, 1);
-        return true;
-      }
-      if (ch >= 32 && ch <= 126) {
-        query.insert(query_pos, 1, (char)ch);
-        ++query_pos;
-        return true;
-      }
+    break;
+  case ACT_LEFT:
+    if (query_pos > 0)
+      --query_pos;
+    break;
+  case ACT_RIGHT:
+    if (!accept_completion() && query_pos < query.size())
+      ++query_pos;
+    break;
+  case ACT_ERASE:
+    if (query_pos > 0) {
+      query.erase(query_pos - 1, 1);
+      --query_pos;
     }
+    break;
+  case ACT_DELETE:
+    if (query_pos < query.size())
+      query.erase(query_pos, 1);
+    break;
+  case ACT_TYPE:
+    query.insert(query_pos, 1, (char)ch);
+    ++query_pos;
+    break;
+  default:
+    break;
   }
+}
 
-  if (focus != SEARCH) {
-    auto restore_channel_origin = [&]() {
-      reset_search_state();
-      Focus target =
-          channel_return_active ? channel_return_focus : SUBSCRIPTIONS;
-      size_t selection =
-          channel_return_active
-              ? channel_return_sel
-              : (subs_channel_idx >= 0 ? (size_t)subs_channel_idx : 0);
-      channel_return_active = false;
-      auto clamp = [&](size_t sz) {
-        return sz == 0 ? (size_t)0 : std::min(selection, sz - 1);
-      };
-      subs_channel_idx = -1;
-      switch (target) {
-      case SUBSCRIPTIONS:
-        focus = SUBSCRIPTIONS;
-        sel = subs.empty() ? 0 : clamp(subs.size());
-        break;
-      case RESULTS:
-        focus = RESULTS;
-        sel = res.empty() ? 0 : clamp(res.size());
-        break;
-      case DOWNLOADS: {
-        focus = DOWNLOADS;
-        const auto &items = ensure_download_items();
-        sel = items.empty() ? 0 : clamp(items.size());
-        break;
-      }
-      case SEARCH:
-        focus = SEARCH;
-        sel = 0;
-        break;
-      case HOME:
-      default:
-        focus = (target == HOME ? HOME : target);
-        sel = (target == HOME ? 0 : selection);
-        break;
-      }
-      scroll_for_focus(focus) = 0;
-      if (focus_has_video_content(focus))
-        refresh_thumbnail();
-      else
-        hide_thumbnail();
-    };
-
-    const std::vector<Video> *list = nullptr;
-    std::function<void()> onBack, onSelect, onDownload;
-
-    if (focus == RESULTS) {
-      list = &res;
-      onBack = [&] { set_focus(SEARCH); };
-      onSelect = [&] { play(res[sel]); };
-    } else if (focus == CHANNEL) {
-      if (navBack || ch == 27) {
-        restore_channel_origin();
-        return true;
-      }
-      if (channel_videos.empty())
-        return true;
-      list = &channel_videos;
-      onSelect = [&] { play(channel_videos[sel]); };
-      onDownload = [&] { enqueue_download(channel_videos[sel]); };
-    } else if (focus == DOWNLOADS) {
-      const auto &items = ensure_download_items();
-      list = &items;
-      onBack = [&] {
-        set_focus(HOME);
-        refresh_thumbnail();
-      };
-      onSelect = [&] { play(items[sel]); };
-      onDownload = [&] { enqueue_download(items[sel]); };
-    } else if (focus == HOME) {
-      if (history.empty())
-        return true;
-      list = &history;
-      onSelect = [&] { play(history[sel]); };
-      onDownload = [&] { enqueue_download(history[sel]); };
-    } else if (focus == SUBSCRIPTIONS) {
-      if (subs.empty())
-        return true;
-      if (handle_list_navigation(
-              subs.size(),
-              [&] {
-                set_focus(HOME);
-                refresh_thumbnail();
-              },
-              [&] { enter_subscription_channel(sel); }))
-        return true;
-      list = nullptr;
+// False when the key asks to quit.
+bool run_action(Action action, int ch) {
+  switch (action) {
+  case ACT_NONE:
+    break;
+  case ACT_QUIT:
+    return false;
+  case ACT_PERF:
+    perf_overlay = !perf_overlay;
+    break;
+  case ACT_FILTER_CANCEL:
+    clear_filter();
+    sel = 0;
+    selection_moved = true;
+    break;
+  case ACT_FILTER_DONE:
+    filter_editing = false;
+    break;
+  case ACT_FILTER_ERASE:
+    if (filter_query.empty()) {
+      filter_editing = false;
+      break;
+    }
+    filter_query.pop_back();
+    sel = 0;
+    selection_moved = true;
+    break;
+  case ACT_FILTER_TYPE:
+    filter_query += (char)ch;
+    sel = 0;
+    selection_moved = true;
+    break;
+  case ACT_GO_HOME:
+    set_focus(HOME);
+    break;
+  case ACT_GO_SEARCH:
+    set_focus(SEARCH);
+    break;
+  case ACT_GO_DOWNLOADS:
+    set_focus(DOWNLOADS);
+    break;
+  case ACT_GO_SUBS:
+    set_focus(SUBSCRIPTIONS);
+    break;
+  case ACT_GO_FEED:
+    set_focus(FEED);
+    if (feed_videos.empty() && subs_refresh_total == 0)
+      set_status("Feed is empty, press R to refresh subscriptions");
+    break;
+  case ACT_SORT:
+    if (sort_focus != focus)
+      list_sort = SORT_LISTED;
+    list_sort = (SortOrder)((list_sort + 1) % (SORT_LONGEST + 1));
+    sort_focus = focus;
+    sel = 0;
+    set_status(std::string("Sorted by ") + sort_name(list_sort));
+    selection_moved = true;
+    break;
+  case ACT_FILTER:
+    clear_filter();
+    filter_focus = focus;
+    filter_editing = true;
+    with_focused_list([](const auto &view) { prepare_filter(view.base); });
+    break;
+  case ACT_CHANNEL:
+    if (focus != RESULTS && focus != FEED && focus != DOWNLOADS)
+      break;
+    with_focused_list([](const auto &view) {
+      if (sel >= view.size())
+        return;
+      remember_channel_origin(focus, sel);
+      show_channel_for(view[sel]);
+    });
+    break;
+  case ACT_SUB_TOGGLE:
+    with_focused_list([](const auto &view) {
+      if (sel < view.size())
+        toggle_subscription(view[sel]);
+    });
+    break;
+  case ACT_REFRESH:
+    refresh_channel();
+    break;
+  case ACT_REFRESH_ALL:
+    refresh_all_subscriptions();
+    break;
+  default:
+    if (focus == SEARCH) {
+      search_key(action, ch);
+    } else if (action == ACT_BACK) {
+      go_back();
+    } else if (action == ACT_SELECT && focus == SUBSCRIPTIONS) {
+      if (sel < subs.size())
+        enter_subscription_channel(sel);
+    } else if (action == ACT_SELECT) {
+      with_focused_list([](const auto &view) {
+        if (sel < view.size())
+          play(view[sel]);
+      });
+    } else if (action == ACT_DOWNLOAD) {
+      with_focused_list([](const auto &view) {
+        if (sel < view.size())
+          enqueue_download(view[sel]);
+      });
     }
+    break;
+  }
+  return true;
+}
 
-    if (list && handle_video_list(*list, onBack, onSelect, onDownload))
-      return true;
+} // namespace
+
+bool handle_input() {
+  int keys[INPUT_BATCH_KEYS];
+  size_t n = 0;
+  int ch;
+  resume_cell_size_reply();
+  while (n < (size_t)INPUT_BATCH_KEYS && (ch = getch()) != ERR) {
+    if (ch == 27 && take_cell_size_reply())
+      continue;
+    keys[n++] = ch;
+  }
+  if (n == 0)
     return true;
+  perf_key_read();
+  PerfScope timer(PERF_INPUT);
+  TraceSpan span("handle_input");
+
+  for (size_t i = 0; i < n;) {
+    Action action = key_action(keys[i]);
+    if ((action == ACT_DOWN || action == ACT_UP) && focus != SEARCH) {
+      size_t run = 1;
+      while (i + run < n) {
+        Action next = key_action(keys[i + run]);
+        if (next != ACT_DOWN && next != ACT_UP)
+          break;
+        ++run;
+      }
+      move_selection(keys + i, run);
+      i += run;
+      continue;
+    }
+    if (!run_action(action, keys[i]))
+      return false;
+    ++i;
+  }
+  if (selection_moved) {
+    selection_moved = false;
+    refresh_thumbnail();
   }
-
   return true;
 }
+
+bool ui_frame() {
+  TraceSpan span("frame");
+  uint64_t start = perf_now();
+  if (!output_poll())
+    return false;
+  run_main_tasks();
+  draw();
+  redraw_thumbnail();
+  output_present();
+  perf_frame_done();
+  bool run = handle_input();
+  perf_record(PERF_FRAME, perf_now() - start);
+  return run;
+}
@@ -1,9 +1,19 @@
 #ifndef UI_H
 #define UI_H
 
+#include <cstdio>
+
 void init_ui();
+// Draw to out instead of the terminal, with no input but ungetch(); for
+// replay.cpp. The screen size comes from LINES and COLUMNS.
+void init_ui_headless(FILE *out);
 void cleanup_ui();
 void draw();
+// Handles every key waiting, up to INPUT_BATCH_KEYS. False on quit.
 bool handle_input();
+// One main loop iteration: UI-thread tasks, a frame, and the keys that came
+// in meanwhile.
+// False once the user quits.
+bool ui_frame();
 
 #endif
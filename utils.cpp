@@ -1,38 +1,39 @@
 #include "utils.h"
 
+#include "catalog.h"
+#include "chanmap.h"
 #include "config.h"
 #include "globals.h"
+#include "image.h"
+#include "output.h"
+#include "perf.h"
+#include "persist.h"
+#include "tasks.h"
+#include "trace.h"
 #include "types.h"
 #include "youtube.h"
 
 #include <algorithm>
-#include <array>
 #include <cctype>
 #include <cerrno>
+#include <climits>
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <ctime>
-#include <dirent.h>
+#include <cwchar>
 #include <fcntl.h>
 #include <fstream>
-#include <jpeglib.h>
+#include <memory>
 #include <ncurses.h>
-#include <sys/select.h>
+#include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
 #include <thread>
 #include <unistd.h>
 #include <vector>
 
-static const std::array<const char *, 2> VIDEO_EXT = {"mkv", "mp4"};
-static const size_t YT_ID_LEN = 11;
-
-static bool is_video_ext(const std::string &ext) {
-  return std::any_of(VIDEO_EXT.begin(), VIDEO_EXT.end(),
-                     [&](const char *e) { return ext == e; });
-}
-
 bool file_exists(const std::string &path) {
   struct stat st;
   return stat(path.c_str(), &st) == 0;
@@ -55,97 +56,148 @@ void set_status(const std::string &msg) {
   status_time = time(nullptr);
 }
 
-std::string find_cached_path_by_id(const std::string &id) {
-  DIR *d = opendir(VIDEO_CACHE.c_str());
-  if (!d)
-    return {};
-  struct dirent *ent;
-  while ((ent = readdir(d)) != nullptr) {
-    if (ent->d_type != DT_REG)
-      continue;
-    std::string name(ent->d_name);
-    size_t dot = name.rfind('.');
-    if (dot == std::string::npos)
-      continue;
-    if (!is_video_ext(name.substr(dot + 1)))
-      continue;
-    std::string base = name.substr(0, dot);
-    if (base.size() >= id.size() &&
-        base.compare(base.size() - id.size(), id.size(), id) == 0) {
-      closedir(d);
-      return VIDEO_CACHE + '/' + name;
-    }
+std::string find_cached_path_by_id(const VideoId &id) {
+  catalog_sync();
+  const CatalogEntry *e = catalog_find(id);
+  return e ? e->v.path.str() : std::string();
+}
+
+// While nothing is in progress this is the catalog's own snapshot;
+// otherwise the merged list is kept until the catalog or the queue changes.
+VideoList collect_download_items() {
+  catalog_sync();
+  const VideoList &done = catalog_videos();
+  std::vector<Video> pending;
+  for (const auto &dl : downloads)
+    if (!catalog_find(dl.v.id))
+      pending.push_back(dl.v);
+  if (pending.empty())
+    return done;
+  static VideoList merged, merged_done;
+  static std::vector<Video> merged_pending;
+  if (!merged_done.shares(done) || merged_pending != pending) {
+    std::vector<Video> out;
+    out.reserve(done.size() + pending.size());
+    out.insert(out.end(), pending.begin(), pending.end());
+    out.insert(out.end(), done.begin(), done.end());
+    merged = std::move(out);
+    merged_done = done;
+    merged_pending = std::move(pending);
   }
-  closedir(d);
-  return {};
+  return merged;
 }
 
-std::vector<Video> scan_video_cache() {
-  std::vector<Video> out;
-  DIR *d = opendir(VIDEO_CACHE.c_str());
-  if (!d)
-    return out;
-  struct dirent *ent;
-  while ((ent = readdir(d)) != nullptr) {
-    if (ent->d_type != DT_REG)
-      continue;
-    std::string name(ent->d_name);
-    size_t dot = name.rfind('.');
-    if (dot == std::string::npos)
-      continue;
-    if (!is_video_ext(name.substr(dot + 1)))
-      continue;
-    std::string base = name.substr(0, dot);
-    Video v;
-    v.path = VIDEO_CACHE + '/' + name;
-    if (base.size() >= YT_ID_LEN) {
-      v.id = base.substr(base.size() - YT_ID_LEN);
-      v.title = base.substr(0, base.size() - YT_ID_LEN);
-    } else {
-      v.id = v.title = base;
-    }
-    out.push_back(std::move(v));
+void update_download_statuses() {
+  catalog_sync();
+  for (auto &dl : downloads) {
+    dl.done = catalog_find(dl.v.id) != nullptr;
+    if (dl.done)
+      dl.pid = 0;
   }
-  closedir(d);
-  return out;
 }
 
-bool is_video_downloaded(const Video &v) {
-  return !find_cached_path_by_id(v.id).empty();
+std::string video_meta(const Video &v) {
+  std::string out;
+  char buf[32];
+  auto add = [&](const char *part) {
+    if (!out.empty())
+      out += "  ";
+    out += part;
+  };
+  if (v.duration > 0) {
+    unsigned h = v.duration / 3600, m = v.duration / 60 % 60,
+             s = v.duration % 60;
+    if (h > 0)
+      snprintf(buf, sizeof(buf), "%u:%02u:%02u", h, m, s);
+    else
+      snprintf(buf, sizeof(buf), "%u:%02u", m, s);
+    add(buf);
+  }
+  if (v.view_count > 0) {
+    static const char *const UNITS[] = {"", "K", "M", "B"};
+    double n = (double)v.view_count;
+    int u = 0;
+    while (n >= 1000 && u < 3) {
+      n /= 1000;
+      ++u;
+    }
+    if (u == 0)
+      snprintf(buf, sizeof(buf), "%llu views",
+               (unsigned long long)v.view_count);
+    else
+      snprintf(buf, sizeof(buf), n < 10 ? "%.1f%s views" : "%.0f%s views", n,
+               UNITS[u]);
+    add(buf);
+  }
+  if (v.upload_date > 0) {
+    snprintf(buf, sizeof(buf), "%04u-%02u-%02u", v.upload_date / 10000,
+             v.upload_date / 100 % 100, v.upload_date % 100);
+    add(buf);
+  }
+  return out;
 }
 
-std::vector<Video> collect_download_items(const std::vector<Video> &cached) {
-  std::vector<Video> out;
-  out.reserve(cached.size() + downloads.size());
-  out.insert(out.end(), cached.begin(), cached.end());
-  for (const auto &dl : downloads) {
-    bool hit = std::any_of(cached.begin(), cached.end(),
-                           [&](const Video &c) { return c.id == dl.v.id; });
-    if (hit)
-      continue;
-    Video v = dl.v;
-    v.path = VIDEO_CACHE + '/' + v.id + ".mkv";
-    out.push_back(std::move(v));
+std::string file_size(uint64_t bytes) {
+  static const char *const UNITS[] = {"B", "KB", "MB", "GB", "TB"};
+  double n = (double)bytes;
+  int u = 0;
+  while (n >= 1024 && u < 4) {
+    n /= 1024;
+    ++u;
   }
-  return out;
+  char buf[32];
+  snprintf(buf, sizeof(buf), u > 0 && n < 10 ? "%.1f %s" : "%.0f %s", n,
+           UNITS[u]);
+  return buf;
+}
+
+// Bytes of the longest prefix of s that fits in width columns; its width
+// goes to *used.
+static size_t fit_width(std::string_view s, int width, int *used) {
+  size_t i = 0;
+  int cols = 0;
+  mbstate_t state = {};
+  while (i < s.size()) {
+    unsigned char c = (unsigned char)s[i];
+    size_t len = 1;
+    int w = 1;
+    if (c >= 0x80) {
+      wchar_t wc;
+      size_t n = mbrtowc(&wc, s.data() + i, s.size() - i, &state);
+      if (n == (size_t)-1 || n == (size_t)-2 || n == 0) {
+        state = {};
+      } else {
+        len = n;
+        w = std::max(0, wcwidth(wc));
+      }
+    }
+    if (cols + w > width)
+      break;
+    cols += w;
+    i += len;
+  }
+  *used = cols;
+  return i;
 }
 
-std::vector<Video> collect_download_items() {
-  auto c = scan_video_cache();
-  return collect_download_items(c);
+int text_width(std::string_view s) {
+  int used = 0;
+  fit_width(s, INT_MAX, &used);
+  return used;
 }
 
-void update_download_statuses(const std::vector<Video> &cached) {
-  for (auto &dl : downloads) {
-    bool found = std::any_of(cached.begin(), cached.end(),
-                             [&](const Video &c) { return c.id == dl.v.id; });
-    dl.done = found;
-    if (found)
-      dl.pid = 0;
-  }
+std::string clip_text(std::string_view s, int width) {
+  int used = 0;
+  size_t n = fit_width(s, width, &used);
+  if (n == s.size())
+    return std::string(s);
+  if (width < 3)
+    return std::string(s.substr(0, n));
+  n = fit_width(s, width - 3, &used);
+  return std::string(s.substr(0, n)) + "...";
 }
 
-std::string esc(const std::string &s) {
+std::string esc(std::string_view s) {
   std::string out;
   out.reserve(s.size());
   for (char c : s) {
@@ -178,53 +230,96 @@ std::string unesc(const std::string &s) {
   return out;
 }
 
-void load_search_hist() {
+// Set while load_state_async() runs; see install_state().
+static bool g_state_loading = false;
+static bool g_subs_loaded = false;
+
+// The search history file starts with SEARCH_HIST_MAGIC and holds one
+// "uses|last|score|query" line per query. Older files are a bare list of
+// queries, newest first; those load as one use each.
+static const char SEARCH_HIST_MAGIC[] = "ytui-sh 1";
+
+static void read_search_hist(Completer &completer) {
+  completer.clear();
   std::ifstream f(SEARCH_HISTORY_FILE);
   std::string line;
-  while (std::getline(f, line))
-    if (!line.empty())
-      search_hist.push_back(line);
+  std::vector<std::string> legacy;
+  bool tagged = std::getline(f, line) && line == SEARCH_HIST_MAGIC;
+  if (!tagged && !line.empty())
+    legacy.push_back(line);
+  while (std::getline(f, line)) {
+    if (line.empty())
+      continue;
+    if (!tagged) {
+      legacy.push_back(line);
+      continue;
+    }
+    size_t a = line.find('|');
+    size_t b = a == std::string::npos ? a : line.find('|', a + 1);
+    size_t c = b == std::string::npos ? b : line.find('|', b + 1);
+    if (c == std::string::npos || c + 1 == line.size())
+      continue;
+    Completer::Entry e;
+    e.uses = (uint32_t)strtoul(line.c_str(), nullptr, 10);
+    e.last = strtoull(line.c_str() + a + 1, nullptr, 10);
+    e.score = strtod(line.c_str() + b + 1, nullptr);
+    e.text = line.substr(c + 1);
+    completer.restore(std::move(e));
+  }
+  for (size_t i = 0; i < legacy.size(); ++i) {
+    uint64_t t = legacy.size() - 1 - i;
+    completer.restore({legacy[i], 1, t, (double)t / SEARCH_HIST_HALF_LIFE});
+  }
+}
+
+void load_search_hist() {
+  read_search_hist(search_completer);
+  search_hist = search_completer.recent(SEARCH_HIST_RECENT);
 }
 
 void save_search_hist() {
-  std::ofstream f(SEARCH_HISTORY_FILE);
-  for (const auto &s : search_hist)
-    f << s << '\n';
+  // Until the saved history is in, this would replace it with the few
+  // queries made since launch; installing it saves the merged list.
+  if (g_state_loading)
+    return;
+  persist_replace(SEARCH_HISTORY_FILE,
+                  [entries = search_completer.entries()]() {
+                    std::string out = SEARCH_HIST_MAGIC;
+                    out += '\n';
+                    char head[64];
+                    for (const auto &e : entries) {
+                      snprintf(head, sizeof(head), "%u|%llu|%.6f|", e.uses,
+                               (unsigned long long)e.last, e.score);
+                      out += head;
+                      out += e.text;
+                      out += '\n';
+                    }
+                    return out;
+                  });
 }
 
 void add_search_hist(const std::string &s) {
-  auto it = std::find(search_hist.begin(), search_hist.end(), s);
-  if (it != search_hist.end())
-    search_hist.erase(it);
-  search_hist.insert(search_hist.begin(), s);
-  if (search_hist.size() > 50)
-    search_hist.resize(50);
+  search_completer.use(s);
+  search_hist = search_completer.recent(SEARCH_HIST_RECENT);
   save_search_hist();
 }
 
-void load_history() {
-  std::ifstream f(HISTORY_FILE);
-  std::string line;
-  while (std::getline(f, line)) {
-    size_t sep = line.find("|||");
-    if (sep == std::string::npos)
-      continue;
-    Video v;
-    v.id = line.substr(0, sep);
-    v.title = unesc(line.substr(sep + 3));
-    v.path = VIDEO_CACHE + '/' + v.id + ".mkv";
-    history.push_back(v);
+void load_history() { history.load(HISTORY_FILE, HISTORY_JOURNAL); }
+
+void prefetch_history_channels() {
+  std::vector<VideoId> ids;
+  for (size_t i = 0; i < history.size() && i < CHANNEL_PREFETCH_RECENT; ++i) {
+    Video v = history[i];
+    if (!channel_map_fill(v))
+      ids.push_back(v.id);
   }
+  channel_map_resolve(ids);
 }
 
-void save_history() {
-  std::ofstream f(HISTORY_FILE);
-  for (const auto &v : history)
-    f << v.id << "|||" << esc(v.title) << '\n';
-}
+void save_history() { history.compact(); }
 
-void load_subs() {
-  subs.clear();
+static std::vector<Channel> read_subs() {
+  std::vector<Channel> list;
   std::ifstream f(SUBS_FILE);
   std::string line;
   while (std::getline(f, line)) {
@@ -244,33 +339,124 @@ void load_subs() {
     } else {
       ch.name = ch.url = line;
     }
-    subs.push_back(ch);
+    list.push_back(ch);
   }
+  return list;
 }
 
+void load_subs() {
+  subs = read_subs();
+  g_subs_loaded = true;
+}
+
+void ensure_subs() {
+  if (!g_subs_loaded)
+    load_subs();
+}
+
+void load_state() {
+  mkdirs();
+  load_search_hist();
+  load_history();
+  load_subs();
+  channel_map_load();
+  catalog_load();
+  prefetch_history_channels();
+}
+
+namespace {
+
+struct SavedState {
+  History history;
+  Completer searches;
+  std::vector<Channel> subs;
+  std::vector<CatalogEntry> catalog;
+};
+
+// Plays and searches made while the state loaded are newer than anything
+// saved, so they go on top of it, in the order they happened.
+void install_state(SavedState &s) {
+  std::vector<Video> played = history.snapshot();
+  history = std::move(s.history);
+  for (auto it = played.rbegin(); it != played.rend(); ++it)
+    history.record(*it);
+
+  std::vector<Completer::Entry> searched = search_completer.entries();
+  std::sort(searched.begin(), searched.end(),
+            [](const Completer::Entry &a, const Completer::Entry &b) {
+              return a.last < b.last;
+            });
+  search_completer = std::move(s.searches);
+  for (const auto &e : searched)
+    search_completer.use(e.text);
+  search_hist = search_completer.recent(SEARCH_HIST_RECENT);
+
+  // A subscription toggled meanwhile has loaded them already.
+  if (!g_subs_loaded) {
+    subs = std::move(s.subs);
+    g_subs_loaded = true;
+  }
+  catalog_install(std::move(s.catalog));
+  g_state_loading = false;
+  if (!searched.empty())
+    save_search_hist();
+  prefetch_history_channels();
+}
+
+} // namespace
+
+void load_state_async() {
+  mkdirs();
+  g_state_loading = true;
+  run_async([] {
+    TraceSpan span("load_state");
+    PerfScope timer(PERF_STATE_LOAD);
+    auto s = std::make_shared<SavedState>();
+    s->history.load(HISTORY_FILE, HISTORY_JOURNAL);
+    read_search_hist(s->searches);
+    s->subs = read_subs();
+    s->catalog = catalog_read();
+    channel_map_load();
+    post_main([s] { install_state(*s); });
+  });
+}
+
+bool state_loading() { return g_state_loading; }
+
 void save_subs() {
-  std::ofstream f(SUBS_FILE);
-  for (const auto &ch : subs)
-    f << ch.name << '|' << ch.url << '\n';
+  persist_replace(SUBS_FILE, [list = subs]() {
+    std::string out;
+    for (const auto &ch : list)
+      out += ch.name + '|' + ch.url + '\n';
+    return out;
+  });
 }
 
-void toggle_subscription(const Video &v) {
-  if (v.channel_url.empty()) {
-    set_status("No channel URL available");
+void toggle_subscription(const Video &entry) {
+  ensure_subs();
+  Video v = entry;
+  if (v.channel_url.empty() && !channel_map_fill(v)) {
+    set_status("Looking up channel...");
+    channel_map_resolve({v.id}, [v]() mutable {
+      if (channel_map_fill(v))
+        toggle_subscription(v);
+      else
+        set_status("No channel URL available");
+    });
     return;
   }
 
   auto it = std::find_if(subs.begin(), subs.end(), [&](const Channel &ch) {
-    return ch.url == v.channel_url;
+    return v.channel_url == ch.url;
   });
 
   if (it != subs.end()) {
     subs.erase(it);
-    set_status("Unsubscribed from: " + v.channel_name);
+    set_status("Unsubscribed from: " + v.channel_name.str());
   } else {
     Channel ch;
-    ch.name = v.channel_name.empty() ? v.channel_url : v.channel_name;
-    ch.url = v.channel_url;
+    ch.name = (v.channel_name.empty() ? v.channel_url : v.channel_name).str();
+    ch.url = v.channel_url.str();
     subs.push_back(ch);
     set_status("Subscribed to: " + ch.name);
   }
@@ -281,34 +467,30 @@ void toggle_subscription(const Video &v) {
 void play(const Video &v) {
   std::string local = find_cached_path_by_id(v.id);
   std::string path =
-      local.empty() ? "https://www.youtube.com/watch?v=" + v.id : local;
-  std::string cmd = "setsid mpv ";
+      local.empty() ? "https://www.youtube.com/watch?v=" + v.id.str() : local;
+  std::string cmd = "setsid '" + MPV_BIN + "' ";
   cmd += MPV_ARGS;
   cmd += " '" + path + "' </dev/null >/dev/null 2>&1 &";
   system(cmd.c_str());
   thumbnail_resume_time = time(nullptr) + 8;
   hide_thumbnail();
-  auto it = std::find(history.begin(), history.end(), v);
-  if (it != history.end()) {
-    Video tmp = *it;
-    history.erase(it);
-    history.insert(history.begin(), tmp);
-  } else {
-    history.insert(history.begin(), v);
-  }
-  save_history();
-  set_status("Playing: " + v.title);
+  // v may live inside history; take the title before it moves.
+  Text title = v.title;
+  channel_map_note(v);
+  history.record(v);
+  set_status("Playing: " + title.str());
 }
 
 int enqueue_download(const Video &v) {
   ensure_video_cache();
+  catalog_expect(v);
   Download dl;
   dl.v = v;
   dl.pid = download(v);
   dl.done = false;
-  dl.v.path = VIDEO_CACHE + '/' + v.id + ".mkv";
+  dl.v.path = VIDEO_CACHE + '/' + v.id.str() + ".mkv";
   downloads.insert(downloads.begin(), dl);
-  set_status("Downloading: " + v.title);
+  set_status("Downloading: " + v.title.str());
   return dl.pid;
 }
 
@@ -317,45 +499,170 @@ size_t visible_count(size_t rows, size_t items) {
 }
 
 /* ==========================================================================
- * Kitty thumbnail renderer
+ * Thumbnail renderers
  * ========================================================================== */
 
-static int g_cell_w = 0, g_cell_h = 0;
+enum ThumbRenderer { THUMBS_KITTY, THUMBS_BLOCKS, THUMBS_OFF };
+
+// The kitty graphics protocol on terminals known to speak it, coloured
+// half-block cells everywhere else. THUMBNAILS_ENV overrides the guess.
+static ThumbRenderer thumb_renderer() {
+  static const ThumbRenderer renderer = [] {
+    auto env = [](const char *name) {
+      const char *v = getenv(name);
+      return std::string(v ? v : "");
+    };
+    std::string forced = env(THUMBNAILS_ENV);
+    if (forced == "kitty")
+      return THUMBS_KITTY;
+    if (forced == "blocks")
+      return THUMBS_BLOCKS;
+    if (forced == "off")
+      return THUMBS_OFF;
+    std::string term = env("TERM"), program = env("TERM_PROGRAM");
+    if (term.find("kitty") != std::string::npos || term == "xterm-ghostty" ||
+        !env("KITTY_WINDOW_ID").empty() || program == "WezTerm" ||
+        program == "ghostty")
+      return THUMBS_KITTY;
+    return THUMBS_BLOCKS;
+  }();
+  return renderer;
+}
+
+static bool truecolor() {
+  static const bool yes = [] {
+    const char *ct = getenv("COLORTERM");
+    const char *term = getenv("TERM");
+    std::string t = term ? term : "";
+    return (ct && (!strcmp(ct, "truecolor") || !strcmp(ct, "24bit"))) ||
+           (t.size() > 7 && t.compare(t.size() - 7, 7, "-direct") == 0);
+  }();
+  return yes;
+}
+
+// Cell size in pixels. Terminals that fill in the pixel fields of the
+// window size (kitty, WezTerm, foot) give it without a round trip, and it
+// is read again for every thumbnail, so font size changes are picked up.
+// Others are asked with CSI 16 t; the reply comes in with the keyboard
+// input and is taken out of it by take_cell_size_reply(). Until then the
+// size the terminal last reported, kept in CELL_SIZE_FILE, stands in.
+static int g_cell_w = 10, g_cell_h = 20;
+static bool g_cell_fixed = false; // set_graphics_output()
+static bool g_cell_query_pending = false;
+
+static bool cell_size_from_winsize() {
+  struct winsize ws = {};
+  if (ioctl(output_tty(), TIOCGWINSZ, &ws) != 0 || !ws.ws_xpixel ||
+      !ws.ws_ypixel || !ws.ws_col || !ws.ws_row)
+    return false;
+  g_cell_w = std::max(1, ws.ws_xpixel / ws.ws_col);
+  g_cell_h = std::max(1, ws.ws_ypixel / ws.ws_row);
+  return true;
+}
 
-static void query_cell_size() {
-  g_cell_w = 10;
-  g_cell_h = 20;
-  int fd = open("/dev/tty", O_RDWR | O_CLOEXEC);
-  if (fd < 0)
-    return;
-  if (write(fd, "\033[16t", 5) != 5) {
-    close(fd);
+void probe_cell_size() {
+  if (thumb_renderer() != THUMBS_KITTY || g_cell_fixed ||
+      cell_size_from_winsize())
     return;
+  std::ifstream f(CELL_SIZE_FILE);
+  int w = 0, h = 0;
+  if (f >> w >> h && w > 0 && h > 0) {
+    g_cell_w = w;
+    g_cell_h = h;
   }
-  struct timeval tv = {0, 300000};
-  fd_set fds;
-  FD_ZERO(&fds);
-  FD_SET(fd, &fds);
-  if (select(fd + 1, &fds, nullptr, nullptr, &tv) <= 0) {
-    close(fd);
-    return;
+  output_queue("\033[16t");
+  g_cell_query_pending = true;
+}
+
+// Matches keys, read after an Esc, against "[ 6 ; height ; width t": 1 for
+// a whole reply, 0 for the start of one, -1 when it is not one.
+static int scan_cell_reply(const std::vector<int> &keys, int *ph, int *pw) {
+  static const char lead[] = "[6;";
+  size_t i = 0;
+  for (; i < 3; ++i) {
+    if (i == keys.size())
+      return 0;
+    if (keys[i] != lead[i])
+      return -1;
   }
-  char buf[64] = {};
-  if (read(fd, buf, sizeof(buf) - 1) <= 0) {
-    close(fd);
-    return;
+  int *field[] = {ph, pw};
+  for (int f = 0; f < 2; ++f) {
+    size_t digits = 0;
+    *field[f] = 0;
+    for (; i < keys.size() && keys[i] <= 0xff && isdigit(keys[i]); ++i) {
+      if (++digits > 5)
+        return -1;
+      *field[f] = *field[f] * 10 + (keys[i] - '0');
+    }
+    if (i == keys.size())
+      return 0;
+    if (!digits || keys[i] != (f == 0 ? ';' : 't'))
+      return -1;
+    ++i;
   }
-  close(fd);
-  int ph = 0, pw = 0;
-  if (sscanf(buf, "\033[6;%d;%dt", &ph, &pw) == 2 && pw > 0 && ph > 0) {
-    g_cell_w = pw;
-    g_cell_h = ph;
+  return *ph > 0 && *pw > 0 ? 1 : -1;
+}
+
+// A reply the input ended in the middle of, without its Esc. Over a slow
+// link the rest comes in a later read; until CELL_REPLY_WAIT_MS has passed
+// it is held here rather than taken as keys.
+static std::vector<int> g_cell_partial;
+static uint64_t g_cell_partial_deadline = 0;
+
+// Reads on from keys, the input after an Esc. True when the keys are the
+// reply, or may be and are held back.
+static bool continue_cell_reply(std::vector<int> keys) {
+  int ph = 0, pw = 0, state, c;
+  while ((state = scan_cell_reply(keys, &ph, &pw)) == 0 &&
+         (c = getch()) != ERR)
+    keys.push_back(c);
+  if (state == 1) {
+    g_cell_query_pending = false;
+    g_cell_partial_deadline = 0;
+    if (pw != g_cell_w || ph != g_cell_h) {
+      g_cell_w = pw;
+      g_cell_h = ph;
+      persist_replace(CELL_SIZE_FILE, [pw, ph] {
+        return std::to_string(pw) + ' ' + std::to_string(ph) + '\n';
+      });
+    }
+    return true;
   }
+  if (state == 0) {
+    uint64_t now = perf_now();
+    if (!g_cell_partial_deadline)
+      g_cell_partial_deadline = now + CELL_REPLY_WAIT_MS * 1000000ull;
+    if (now < g_cell_partial_deadline) {
+      g_cell_partial = std::move(keys);
+      return true;
+    }
+    // Given up on: the rest may never come.
+    g_cell_query_pending = false;
+  }
+  g_cell_partial_deadline = 0;
+  for (auto it = keys.rbegin(); it != keys.rend(); ++it)
+    ungetch(*it);
+  return false;
+}
+
+bool take_cell_size_reply() {
+  if (!g_cell_query_pending)
+    return false;
+  return continue_cell_reply({});
+}
+
+void resume_cell_size_reply() {
+  if (!g_cell_query_pending || !g_cell_partial_deadline)
+    return;
+  std::vector<int> keys;
+  keys.swap(g_cell_partial);
+  if (!continue_cell_reply(std::move(keys)))
+    ungetch(27);
 }
 
 static void ensure_cell_size() {
-  if (g_cell_w == 0)
-    query_cell_size();
+  if (!g_cell_fixed)
+    cell_size_from_winsize();
 }
 
 static void thumb_geometry(int *col, int *row, int *cols, int *rows, int *px_w,
@@ -381,193 +688,71 @@ static void thumb_geometry(int *col, int *row, int *cols, int *rows, int *px_w,
   }
 }
 
-static void jpeg_noop_error(j_common_ptr) {}
-static void jpeg_noop_msg(j_common_ptr, int) {}
-
-static bool jpeg_to_rgba(const std::string &path, std::vector<uint8_t> &out,
-                         unsigned &w, unsigned &h) {
-  FILE *f = fopen(path.c_str(), "rb");
-  if (!f)
-    return false;
-  struct jpeg_decompress_struct cinfo = {};
-  struct jpeg_error_mgr jerr = {};
-  cinfo.err = jpeg_std_error(&jerr);
-  jerr.error_exit = jpeg_noop_error;
-  jerr.emit_message = jpeg_noop_msg;
-  jerr.output_message = jpeg_noop_error;
-  jpeg_create_decompress(&cinfo);
-  jpeg_stdio_src(&cinfo, f);
-  if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK) {
-    jpeg_destroy_decompress(&cinfo);
-    fclose(f);
-    return false;
-  }
-  cinfo.out_color_space = JCS_EXT_RGBA;
-  jpeg_start_decompress(&cinfo);
-  w = cinfo.output_width;
-  h = cinfo.output_height;
-  int comp = cinfo.output_components;
-  std::vector<uint8_t> row_buf(w * comp);
-  out.resize(w * h * 4);
-  uint8_t *dst = out.data();
-  while (cinfo.output_scanline < h) {
-    uint8_t *rp = row_buf.data();
-    jpeg_read_scanlines(&cinfo, &rp, 1);
-    if (comp == 4) {
-      memcpy(dst, row_buf.data(), w * 4);
-    } else {
-      for (unsigned x = 0; x < w; ++x) {
-        dst[x * 4 + 0] = row_buf[x * 3 + 0];
-        dst[x * 4 + 1] = row_buf[x * 3 + 1];
-        dst[x * 4 + 2] = row_buf[x * 3 + 2];
-        dst[x * 4 + 3] = 255;
-      }
-    }
-    dst += w * 4;
-  }
-  jpeg_finish_decompress(&cinfo);
-  jpeg_destroy_decompress(&cinfo);
-  fclose(f);
-  return true;
-}
-
-static void rgba_scale(const uint8_t *src, unsigned sw, unsigned sh,
-                       std::vector<uint8_t> &dst, unsigned dw, unsigned dh) {
-  dst.resize((size_t)dw * dh * 4);
-  float sx = (float)sw / dw, sy = (float)sh / dh;
-  for (unsigned y = 0; y < dh; ++y) {
-    float fy = (y + 0.5f) * sy - 0.5f;
-    int y0 = std::max(0, (int)fy), y1 = std::min((int)sh - 1, y0 + 1);
-    float vy = fy - y0;
-    for (unsigned x = 0; x < dw; ++x) {
-      float fx = (x + 0.5f) * sx - 0.5f;
-      int x0 = std::max(0, (int)fx), x1 = std::min((int)sw - 1, x0 + 1);
-      float vx = fx - x0;
-      const uint8_t *p00 = src + ((size_t)y0 * sw + x0) * 4,
-                    *p10 = src + ((size_t)y0 * sw + x1) * 4;
-      const uint8_t *p01 = src + ((size_t)y1 * sw + x0) * 4,
-                    *p11 = src + ((size_t)y1 * sw + x1) * 4;
-      uint8_t *d = dst.data() + ((size_t)y * dw + x) * 4;
-      for (int c = 0; c < 4; ++c)
-        d[c] = (uint8_t)(p00[c] * (1 - vx) * (1 - vy) + p10[c] * vx * (1 - vy) +
-                         p01[c] * (1 - vx) * vy + p11[c] * vx * vy + 0.5f);
-    }
-  }
-}
-
-static void fit_dims(unsigned sw, unsigned sh, unsigned mw, unsigned mh,
-                     unsigned &ow, unsigned &oh) {
-  if (!sw || !sh) {
-    ow = mw;
-    oh = mh;
-    return;
-  }
-  float s = std::min((float)mw / sw, (float)mh / sh);
-  ow = std::max(1u, (unsigned)(sw * s));
-  oh = std::max(1u, (unsigned)(sh * s));
-}
-
-static const char B64[] =
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-
-static std::string b64_encode(const uint8_t *data, size_t len) {
-  std::string out;
-  out.reserve(((len + 2) / 3) * 4);
-  for (size_t i = 0; i < len; i += 3) {
-    unsigned b = (unsigned)data[i] << 16;
-    if (i + 1 < len)
-      b |= (unsigned)data[i + 1] << 8;
-    if (i + 2 < len)
-      b |= (unsigned)data[i + 2];
-    out += B64[(b >> 18) & 63];
-    out += B64[(b >> 12) & 63];
-    out += (i + 1 < len) ? B64[(b >> 6) & 63] : '=';
-    out += (i + 2 < len) ? B64[b & 63] : '=';
-  }
-  return out;
+void set_graphics_output(int fd) {
+  output_queue_to(fd);
+  g_cell_w = 10;
+  g_cell_h = 20;
+  g_cell_fixed = true;
 }
 
-static int g_tty_fd = -1;
-
-static int tty_fd() {
-  if (g_tty_fd < 0) {
-    g_tty_fd = open("/dev/tty", O_RDWR | O_CLOEXEC);
-    if (g_tty_fd < 0)
-      g_tty_fd = fileno(stdout);
-  }
-  return g_tty_fd;
+static void tty_write(const std::string &s) {
+  perf_count(PERF_TTY_BYTES, s.size());
+  output_queue(s);
 }
 
-static void tty_write(const char *buf, size_t len) {
-  int fd = tty_fd();
-  fflush(stdout);
-  while (len > 0) {
-    ssize_t n = write(fd, buf, len);
-    if (n <= 0)
-      break;
-    buf += n;
-    len -= (size_t)n;
+// Where the image is placed, so an unchanged placement is not sent again
+// every frame. Uploading deletes the old image and its placement, and so
+// does a terminal redrawn from scratch (see output_epoch()).
+struct ThumbPlacement {
+  int col = -1, row = -1;
+  unsigned w = 0, h = 0;
+  uint64_t epoch = 0;
+  bool operator==(const ThumbPlacement &o) const {
+    return col == o.col && row == o.row && w == o.w && h == o.h &&
+           epoch == o.epoch;
   }
-}
-static void tty_write(const std::string &s) { tty_write(s.data(), s.size()); }
-
-static const unsigned KITTY_ID = 1;
-static const unsigned KITTY_PID = 1;
-static const size_t KITTY_CHUNK = 4096;
+  bool operator!=(const ThumbPlacement &o) const { return !(*this == o); }
+};
+static ThumbPlacement g_placed;
 
 static void kitty_upload(const std::vector<uint8_t> &rgba, unsigned w,
                          unsigned h) {
   if (rgba.empty() || !w || !h)
     return;
-  std::string enc = b64_encode(rgba.data(), rgba.size());
-  std::string out;
-  out += "\033_Ga=d,d=I,i=" + std::to_string(KITTY_ID) + ",q=2;\033\\";
-  size_t sent = 0;
-  bool first = true;
-  while (sent < enc.size()) {
-    size_t n = std::min(KITTY_CHUNK, enc.size() - sent);
-    int more = (sent + n < enc.size()) ? 1 : 0;
-    if (first) {
-      out += "\033_Ga=t,f=32,i=" + std::to_string(KITTY_ID) +
-             ",s=" + std::to_string(w) + ",v=" + std::to_string(h) +
-             ",q=2,m=" + std::to_string(more) + ";" + enc.substr(sent, n) +
-             "\033\\";
-      first = false;
-    } else {
-      out += "\033_Gm=" + std::to_string(more) + ";" + enc.substr(sent, n) +
-             "\033\\";
-    }
-    sent += n;
-  }
-  tty_write(out);
+  PerfScope timer(PERF_THUMB_UPLOAD);
+  TraceSpan span("kitty_upload");
+  tty_write(kitty_upload_cmd(rgba, w, h));
+  g_placed = {};
 }
 
 static void kitty_place(int col, int row, unsigned w, unsigned h) {
-  std::string out;
-  out += "\0337";
-  out +=
-      "\033[" + std::to_string(row + 1) + ";" + std::to_string(col + 1) + "H";
-  out += "\033_Ga=p,i=" + std::to_string(KITTY_ID) +
-         ",p=" + std::to_string(KITTY_PID) + ",s=" + std::to_string(w) +
-         ",v=" + std::to_string(h) + ",q=2;\033\\";
-  out += "\0338";
-  tty_write(out);
+  ThumbPlacement p{col, row, w, h, output_epoch()};
+  if (p == g_placed)
+    return;
+  tty_write(kitty_place_cmd(col, row, w, h));
+  g_placed = p;
 }
 
 static void kitty_delete() {
-  tty_write("\033_Ga=d,d=I,i=" + std::to_string(KITTY_ID) + ",q=2;\033\\");
+  tty_write(kitty_delete_cmd());
+  g_placed = {};
 }
 
 static const char *THUMB_QUALITIES[] = {"maxresdefault", "hqdefault",
                                         "mqdefault", nullptr};
 
 static std::string fetch_best_thumbnail(const Video &v) {
+  TraceSpan span("fetch_best_thumbnail");
   mkdir(THUMBNAIL_CACHE.c_str(), 0755);
-  std::string dest = THUMBNAIL_CACHE + '/' + v.id + ".jpg";
-  if (file_exists(dest))
+  std::string dest = THUMBNAIL_CACHE + '/' + v.id.str() + ".jpg";
+  if (file_exists(dest)) {
+    perf_count(PERF_THUMB_CACHE_HIT);
     return dest;
+  }
+  perf_count(PERF_THUMB_CACHE_MISS);
+  PerfScope timer(PERF_THUMB_FETCH);
   for (int i = 0; THUMB_QUALITIES[i]; ++i) {
-    std::string url = "https://img.youtube.com/vi/" + v.id + '/' +
+    std::string url = "https://img.youtube.com/vi/" + v.id.str() + '/' +
                       THUMB_QUALITIES[i] + ".jpg";
     pid_t pid = fork();
     if (pid < 0)
@@ -578,8 +763,8 @@ static std::string fetch_best_thumbnail(const Video &v) {
         dup2(devnull, STDERR_FILENO);
         close(devnull);
       }
-      execlp("curl", "curl", "-sS", "-L", "-f", "-o", dest.c_str(), url.c_str(),
-             (char *)nullptr);
+      execlp(CURL_BIN.c_str(), "curl", "-sS", "-L", "-f", "-o", dest.c_str(),
+             url.c_str(), (char *)nullptr);
       _exit(errno == ENOENT ? 127 : 126);
     }
     int status = 0;
@@ -613,15 +798,27 @@ static unsigned g_scaled_w = 0, g_scaled_h = 0;
 static unsigned g_kitty_w = 0, g_kitty_h = 0;
 static bool g_needs_upload = false;
 
+// The half-block renderer writes its cells around ncurses, after the
+// frame's screen update. Each cell is also marked in stdscr with a
+// reversed blank, so ncurses keeps to the rest of the screen: it does not
+// clear to the end of a line across the image, and takes the marks away
+// when the thumbnail goes. g_blocks_shown is what the terminal holds,
+// which lets the next image send only the cells that differ.
+static std::vector<BlockCell> g_blocks, g_blocks_shown;
+static ThumbPlacement g_blocks_at;
+
 static void reset_thumb() {
   g_thumb_path.clear();
   g_thumb_rgba.clear();
   g_thumb_w = g_thumb_h = g_scaled_w = g_scaled_h = g_kitty_w = g_kitty_h = 0;
   g_scaled_rgba.clear();
+  g_blocks.clear();
   g_needs_upload = false;
 }
 
 void show_thumbnail(const Video &v) {
+  if (thumb_renderer() == THUMBS_OFF)
+    return;
   if (thumbnail_resume_time > 0) {
     if (time(nullptr) < thumbnail_resume_time)
       return;
@@ -635,8 +832,10 @@ void show_thumbnail(const Video &v) {
   if (path != g_thumb_path) {
     std::vector<uint8_t> rgba;
     unsigned w = 0, h = 0;
+    uint64_t start = perf_now();
     if (!jpeg_to_rgba(path, rgba, w, h))
       return;
+    perf_record(PERF_THUMB_DECODE, perf_now() - start);
     reset_thumb();
     g_thumb_path = path;
     g_thumb_rgba = std::move(rgba);
@@ -650,16 +849,70 @@ void show_thumbnail(const Video &v) {
 void hide_thumbnail() {
   if (!thumbnail_shown)
     return;
-  kitty_delete();
+  if (thumb_renderer() == THUMBS_KITTY)
+    kitty_delete();
   reset_thumb();
+  g_blocks_shown.clear();
   thumbnail_shown = false;
 }
 
+static void redraw_blocks() {
+  int col, row, cols, rows;
+  thumb_geometry(&col, &row, &cols, &rows, nullptr, nullptr);
+  // A cell holds two pixels, one above the other.
+  unsigned tw = 0, th = 0;
+  fit_dims(g_thumb_w, g_thumb_h, (unsigned)cols, (unsigned)rows * 2, tw, th);
+  th &= ~1u;
+  if (!th)
+    return;
+  if (tw != g_scaled_w || th != g_scaled_h || g_blocks.empty()) {
+    PerfScope timer(PERF_THUMB_SCALE);
+    rgba_downsample(g_thumb_rgba.data(), g_thumb_w, g_thumb_h, g_scaled_rgba,
+                    tw, th);
+    g_scaled_w = tw;
+    g_scaled_h = th;
+    g_blocks = rgba_to_blocks(g_scaled_rgba, tw, th);
+  }
+  ThumbPlacement at{col, row, tw, th / 2, output_epoch()};
+  if (at != g_blocks_at || g_blocks_shown.size() != g_blocks.size())
+    g_blocks_shown.assign(g_blocks.size(), BLOCK_UNKNOWN);
+  g_blocks_at = at;
+
+  // Insert and delete character would shift the cells along with the text.
+  idcok(stdscr, FALSE);
+  // Cells something else was drawn over this frame are left to it, and
+  // drawn again once it is gone.
+  std::vector<size_t> covered;
+  for (size_t i = 0; i < g_blocks.size(); ++i) {
+    int y = row + (int)(i / tw), x = col + (int)(i % tw);
+    if (mvwinch(stdscr, y, x) != ' ') {
+      covered.push_back(i);
+      g_blocks_shown[i] = g_blocks[i];
+    } else {
+      mvwaddch(stdscr, y, x, ' ' | A_REVERSE);
+    }
+  }
+  wnoutrefresh(stdscr);
+  tty_write(blocks_draw_cmd(g_blocks, g_blocks_shown, tw, col, row,
+                            truecolor()));
+  g_blocks_shown = g_blocks;
+  for (size_t i : covered)
+    g_blocks_shown[i] = BLOCK_UNKNOWN;
+}
+
 void redraw_thumbnail() {
-  if (!thumbnail_shown || g_thumb_rgba.empty())
+  if (!thumbnail_shown || g_thumb_rgba.empty() ||
+      (thumbnail_resume_time > 0 && time(nullptr) < thumbnail_resume_time)) {
+    // Nothing marks the cells any more, so ncurses clears them.
+    g_blocks_shown.clear();
     return;
-  if (thumbnail_resume_time > 0 && time(nullptr) < thumbnail_resume_time)
+  }
+  PerfScope timer(PERF_THUMB_DRAW);
+  TraceSpan span("redraw_thumbnail");
+  if (thumb_renderer() == THUMBS_BLOCKS) {
+    redraw_blocks();
     return;
+  }
 
   int col, row, px_w, px_h;
   thumb_geometry(&col, &row, nullptr, nullptr, &px_w, &px_h);
@@ -668,6 +921,7 @@ void redraw_thumbnail() {
   fit_dims(g_thumb_w, g_thumb_h, (unsigned)px_w, (unsigned)px_h, tw, th);
 
   if (tw != g_scaled_w || th != g_scaled_h || g_scaled_rgba.empty()) {
+    PerfScope timer(PERF_THUMB_SCALE);
     rgba_scale(g_thumb_rgba.data(), g_thumb_w, g_thumb_h, g_scaled_rgba, tw,
                th);
     g_scaled_w = tw;
@@ -683,7 +937,10 @@ void redraw_thumbnail() {
   kitty_place(col, row, g_scaled_w, g_scaled_h);
 }
 
-void preload_thumbnails(const std::vector<Video> &list, size_t start) {
+template <typename List>
+static void preload_thumbnails_of(const List &list, size_t start) {
+  if (thumb_renderer() == THUMBS_OFF)
+    return;
   size_t end = std::min(list.size(), start + 5);
   if (start >= end)
     return;
@@ -698,3 +955,11 @@ void preload_thumbnails(const std::vector<Video> &list, size_t start) {
       fetch_best_thumbnail(v);
   }).detach();
 }
+
+void preload_thumbnails(const std::vector<Video> &list, size_t start) {
+  preload_thumbnails_of(list, start);
+}
+
+void preload_thumbnails(const History &list, size_t start) {
+  preload_thumbnails_of(list, start);
+}
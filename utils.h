@@ -1,45 +1,84 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "history.h"
 #include "types.h"
 
 void mkdirs();
 void load_search_hist();
+// Create the directories and load everything the UI starts from.
+void load_state();
+// The same, with the files read on a worker so the first frame need not
+// wait for them. The UI starts out empty and the saved state is merged in
+// on the UI thread; until then state_loading() is true and the search
+// history is not saved.
+void load_state_async();
+bool state_loading();
 
 bool file_exists(const std::string &path);
 void set_status(const std::string &msg);
 
 void play(const Video &v);
 
-// Search history (string list)
+// Search history (recent list plus completion index)
 void save_search_hist();
 void add_search_hist(const std::string &s);
 
 // Video history
 void load_history();
 void save_history();
+// Look up, in the background, the channels of recent history entries that
+// have none, so 'c' and 'S' on them are instant.
+void prefetch_history_channels();
 
 // Subscriptions
 void load_subs();
+void ensure_subs(); // load_subs() unless they already are
 void save_subs();
 void toggle_subscription(const Video &v);
 
-std::vector<Video> scan_video_cache();
-std::vector<Video> collect_download_items();
-std::vector<Video> collect_download_items(const std::vector<Video> &cached);
-void update_download_statuses(const std::vector<Video> &cached);
-bool is_video_downloaded(const Video &v);
-std::string find_cached_path_by_id(const std::string &id);
+// Downloads (see catalog.h for the index of finished ones)
+// Downloads still in progress, then the catalog, newest first.
+VideoList collect_download_items();
+void update_download_statuses();
+std::string find_cached_path_by_id(const VideoId &id);
 void show_thumbnail(const Video &v);
 void hide_thumbnail();
-void redraw_thumbnail(); // call after ncurses refresh() each frame
+void redraw_thumbnail(); // call each frame, after draw()
+// Send thumbnail graphics to fd rather than with the screen, and assume
+// 10x20 pixel cells instead of asking the terminal. For headless runs.
+void set_graphics_output(int fd);
+// Start finding out the terminal's cell size without waiting for it, once
+// ncurses is up. handle_input() passes every Esc to take_cell_size_reply(),
+// which consumes the terminal's answer when that is what follows and
+// otherwise puts the keys back. An answer split across reads is held back
+// until resume_cell_size_reply(), called before reading input, completes
+// it or gives up on it after CELL_REPLY_WAIT_MS.
+void probe_cell_size();
+bool take_cell_size_reply();
+void resume_cell_size_reply();
 void preload_thumbnails(const std::vector<Video> &list, size_t start);
+void preload_thumbnails(const History &list, size_t start);
+
+// "12:34  1.2M views  2024-05-01" from whichever metadata is known.
+std::string video_meta(const Video &v);
+// "812 MB", "1.4 GB".
+std::string file_size(uint64_t bytes);
+
+// Columns UTF-8 text takes on screen. ASCII counts a column a byte without
+// further work; anything else is measured with wcwidth().
+int text_width(std::string_view s);
+// s cut to at most width columns, ending in "..." when anything had to go.
+// Never splits a character.
+std::string clip_text(std::string_view s, int width);
 
 // Utility encoding for safe persistence
-std::string esc(const std::string &s);
+std::string esc(std::string_view s);
 std::string unesc(const std::string &s);
 
 // Downloads
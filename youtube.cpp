@@ -1,24 +1,36 @@
 #include "youtube.h"
 
+#include "cache.h"
+#include "chanmap.h"
 #include "config.h"
 #include "globals.h"
+#include "listing.h"
+#include "perf.h"
+#include "tasks.h"
+#include "trace.h"
 #include "utils.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdio>
+#include <memory>
+#include <set>
 #include <sstream>
+#include <unordered_set>
 #include <utility>
 
 namespace {
 
-constexpr char FIELD_DELIM[] = "|||";
-
 class Pipe {
 public:
     Pipe(const std::string &command, const char *mode = "r")
-        : handle_(popen(command.c_str(), mode)) {}
+        : handle_(open(command, mode)) {}
 
     ~Pipe() {
-        if (handle_) pclose(handle_);
+        if (handle_) {
+            TraceSpan span("pclose");
+            pclose(handle_);
+        }
     }
 
     Pipe(const Pipe &) = delete;
@@ -41,79 +53,426 @@ public:
     explicit operator bool() const { return handle_ != nullptr; }
 
 private:
+    static FILE *open(const std::string &command, const char *mode) {
+        TraceSpan span("popen");
+        return popen(command.c_str(), mode);
+    }
+
     FILE *handle_ = nullptr;
 };
 
-std::string build_fetch_command(const std::string &source, int count) {
+std::string build_fetch_command(const std::string &source, size_t start, int count) {
     std::ostringstream cmd;
-    cmd << "yt-dlp --no-warnings --flat-playlist --print \"%(id)s|||%(title)s|||%(channel_url)s|||%(channel)s\" ";
+    cmd << "'" << YTDLP_BIN << "' --no-warnings --flat-playlist -j ";
+    // -I is 1-based and inclusive; searches must ask for every result up to
+    // the end of the page and then slice.
+    cmd << "-I " << start + 1 << ":" << start + count << " ";
     if (source.find("youtube.com") != std::string::npos ||
         source.find("youtu.be") != std::string::npos) {
-        cmd << "-I 0:" << count << " \"" << source << "\" 2>/dev/null";
+        cmd << "\"" << source << "\" 2>/dev/null";
     } else {
-        cmd << "\"ytsearch" << count << ":" << source << "\" 2>/dev/null";
+        cmd << "\"ytsearch" << start + count << ":" << source << "\" 2>/dev/null";
     }
     return cmd.str();
 }
 
-bool read_line(FILE *handle, std::string &out) {
-    char buf[4096];
-    if (!fgets(buf, sizeof(buf), handle)) return false;
-    out.assign(buf);
-    if (!out.empty() && out.back() == '\n') out.pop_back();
-    return true;
-}
+// Read up to count entries, stopping early at the first id in stop_ids.
+std::vector<Video> read_listing(const std::string &source, size_t start, int count,
+                                const std::unordered_set<VideoId> *stop_ids,
+                                bool *hit_known) {
+    std::vector<Video> videos;
+    if (hit_known) *hit_known = false;
 
-void append_video_from_line(std::vector<Video> &list, const std::string &line) {
-    const size_t d1 = line.find(FIELD_DELIM);
-    if (d1 == std::string::npos) return;
-    const size_t d2 = line.find(FIELD_DELIM, d1 + 3);
-    const size_t d3 = d2 == std::string::npos ? std::string::npos
-                                              : line.find(FIELD_DELIM, d2 + 3);
+    if (count > MAX_LIST_ITEMS) count = MAX_LIST_ITEMS;
+    if (count > 0) videos.reserve(static_cast<size_t>(count));
 
+    PerfScope timer(PERF_FETCH);
+    TraceSpan span("yt-dlp listing");
+    Pipe pipe(build_fetch_command(source, start, count));
+    if (!pipe) return videos;
+
+    LineReader reader(fileno(pipe.get()));
+    std::string_view line;
     Video video;
-    video.id.assign(line, 0, d1);
+    while (reader.next(line)) {
+        if (!parse_listing_json(line, video)) continue;
+        if (stop_ids && stop_ids->count(video.id)) {
+            if (hit_known) *hit_known = true;
+            break;
+        }
+        videos.push_back(video);
+    }
+    channel_map_note(videos);
+    return videos;
+}
 
-    if (d2 != std::string::npos) {
-        video.title.assign(line, d1 + 3, d2 - (d1 + 3));
-        if (d3 != std::string::npos) {
-            video.channel_url.assign(line, d2 + 3, d3 - (d2 + 3));
-            video.channel_name.assign(line, d3 + 3, std::string::npos);
+// Records a successful fetch of the channel's listing. Failed fetches keep
+// the previous time, so the listing is still revalidated when it is due.
+void note_channel_state(const std::string &url, time_t fetched = time(nullptr)) {
+    ChannelState &st = channel_states[cache_key_for_channel(url)];
+    st.fetched = std::max(st.fetched, fetched);
+}
+
+// Lazy pagination state for res and channel_videos. `gen` changes whenever
+// the list is replaced, so a page fetched for an older list is dropped.
+struct Pager {
+    size_t next_start = 0;
+    unsigned gen = 0;
+    bool loading = false;
+    bool exhausted = false;
+};
+
+Pager res_pager, channel_pager;
+
+void reset_pager(Pager &p, size_t have) {
+    ++p.gen;
+    p.loading = false;
+    p.next_start = have;
+    p.exhausted = have < static_cast<size_t>(MAX_LIST_ITEMS);
+}
+
+size_t append_page(VideoList &list, const std::vector<Video> &page) {
+    // Uploads or reranking between page fetches shift entries across page
+    // boundaries, so the same video can show up twice.
+    std::unordered_set<VideoId> have;
+    have.reserve(list.size() + page.size());
+    for (const auto &v : list) have.insert(v.id);
+    std::vector<Video> fresh;
+    for (const auto &v : page)
+        if (have.insert(v.id).second) fresh.push_back(v);
+    if (!fresh.empty()) {
+        std::vector<Video> &l = list.edit();
+        l.insert(l.end(), fresh.begin(), fresh.end());
+    }
+    return fresh.size();
+}
+
+// Cache keys with a background refresh in flight. UI thread only.
+std::set<std::string> revalidating;
+
+// Swap in a refreshed list, keeping the same video selected if it survived.
+void replace_keep_selection(VideoList &list, VideoList fresh, bool active) {
+    if (!active) {
+        list = std::move(fresh);
+        return;
+    }
+    VideoId selected_id = sel < list.size() ? list[sel].id : VideoId();
+    list = std::move(fresh);
+    auto it = std::find_if(list.begin(), list.end(),
+                           [&](const Video &v) { return v.id == selected_id; });
+    if (it != list.end()) {
+        sel = static_cast<size_t>(it - list.begin());
+        return;
+    }
+    if (sel >= list.size()) sel = list.empty() ? 0 : list.size() - 1;
+    if (list.empty()) hide_thumbnail();
+    else show_thumbnail(list[sel]);
+}
+
+// Installs a background refresh of the first `head` entries of a paged
+// list. Pages appended while it ran are kept after the refreshed head, and
+// the pager goes on from where they end.
+void apply_refreshed_head(VideoList &list, Pager &pager, VideoList fresh, size_t head,
+                          bool active) {
+    if (list.size() <= head) {
+        replace_keep_selection(list, std::move(fresh), active);
+        reset_pager(pager, list.size());
+        return;
+    }
+    std::unordered_set<VideoId> have;
+    have.reserve(fresh.size());
+    for (const auto &v : fresh) have.insert(v.id);
+    std::vector<Video> &merged = fresh.edit();
+    for (size_t i = head; i < list.size(); ++i)
+        if (have.insert(list[i].id).second) merged.push_back(list[i]);
+    replace_keep_selection(list, std::move(fresh), active);
+}
+
+void apply_listing(const std::string &key, VideoList videos, size_t head) {
+    if (!res_source.empty() && cache_key_for_query(res_source) == key) {
+        apply_refreshed_head(res, res_pager, std::move(videos), head, focus == RESULTS);
+        return;
+    }
+    for (size_t i = 0; i < subs.size(); ++i) {
+        if (cache_key_for_channel(subs[i].url) != key) continue;
+        if (subs_cache.size() <= i) subs_cache.resize(i + 1);
+        subs_cache[i] = videos;
+    }
+    if (!channel_url.empty() && cache_key_for_channel(channel_url) == key) {
+        apply_refreshed_head(channel_videos, channel_pager, std::move(videos), head,
+                             focus == CHANNEL);
+    }
+}
+
+// Channels refresh incrementally against the cached listing; searches have
+// no stable order, so they are always refetched whole.
+void revalidate(const std::string &key, const std::string &source,
+                const VideoList &known, bool is_channel) {
+    if (!revalidating.insert(key).second) return;
+    run_async([key, source, known, is_channel]() {
+        std::vector<Video> videos;
+        if (is_channel) {
+            ChannelUpdate up = fetch_channel_update(source, known);
+            if (up.fetched) videos = std::move(up.videos);
         } else {
-            video.channel_url.assign(line, d2 + 3, std::string::npos);
+            videos = fetch_video_list(source);
+        }
+        // An empty listing means the fetch failed; the record stays as it was.
+        time_t fetched = time(nullptr);
+        cache_store(key, videos, fetched);
+        // The refresh covers the cached entries the list started out with.
+        size_t head = known.size();
+        post_main([key, source, is_channel, fetched, head,
+                   videos = std::move(videos)]() mutable {
+            revalidating.erase(key);
+            if (videos.empty()) return;
+            if (is_channel) note_channel_state(source, fetched);
+            apply_listing(key, std::move(videos), head);
+        });
+    });
+}
+
+bool load_cached(const std::string &key, const std::string &source,
+                 VideoList &out, bool is_channel) {
+    time_t fetched = 0;
+    std::vector<Video> videos;
+    if (!cache_load(key, videos, &fetched)) return false;
+    out = std::move(videos);
+    if (is_channel) {
+        // A fetch this session (e.g. refresh-all) may be newer than the record.
+        note_channel_state(source, fetched);
+        fetched = channel_states[key].fetched;
+    }
+    if (cache_is_stale(key, fetched)) revalidate(key, source, out, is_channel);
+    return true;
+}
+
+// Bookkeeping for a running refresh-all. Only touched on the UI thread,
+// except `next`, which the workers use to claim channels.
+struct SubsRefresh {
+    std::vector<Channel> channels;
+    std::atomic<size_t> next{0};
+    std::vector<std::vector<Video>> fresh; // per channel, newest first
+};
+
+std::shared_ptr<SubsRefresh> subs_refresh;
+
+std::vector<Video> new_uploads(const std::vector<Video> &before, const std::vector<Video> &after) {
+    std::unordered_set<VideoId> known;
+    for (const auto &v : before) known.insert(v.id);
+    std::vector<Video> out;
+    for (const auto &v : after) {
+        if (out.size() >= FEED_MAX_PER_CHANNEL) break;
+        if (!known.count(v.id)) out.push_back(v);
+    }
+    return out;
+}
+
+// Interleave the per-channel lists round-robin so no single busy channel
+// buries the others, dropping videos that appear under several channels.
+std::vector<Video> merge_feed(const std::vector<std::vector<Video>> &lists) {
+    std::vector<Video> out;
+    std::unordered_set<VideoId> seen;
+    for (size_t rank = 0;; ++rank) {
+        bool any = false;
+        for (const auto &l : lists) {
+            if (rank >= l.size()) continue;
+            any = true;
+            if (seen.insert(l[rank].id).second) out.push_back(l[rank]);
+        }
+        if (!any) break;
+    }
+    return out;
+}
+
+void finish_subs_refresh() {
+    feed_videos = merge_feed(subs_refresh->fresh);
+    if (focus == FEED) {
+        sel = 0;
+        feed_scroll = 0;
+        if (feed_videos.empty()) hide_thumbnail();
+        else show_thumbnail(feed_videos[0]);
+    }
+    set_status("Feed: " + std::to_string(feed_videos.size()) + " new videos from " +
+               std::to_string(subs_refresh->channels.size()) + " channels");
+    subs_refresh.reset();
+    subs_refresh_total = subs_refresh_done = 0;
+}
+
+void apply_subs_refresh(size_t idx, VideoList before, std::vector<Video> fetched) {
+    const size_t head = before.size();
+    // A failed fetch leaves the channel's previous listing alone.
+    if (!fetched.empty()) {
+        const Channel &ch = subs_refresh->channels[idx];
+        // Channel tabs often omit the uploader fields; the subscription knows them.
+        for (auto &v : fetched) {
+            if (v.channel_url.empty()) v.channel_url = ch.url;
+            if (v.channel_name.empty()) v.channel_name = ch.name;
+        }
+        VideoList videos(std::move(fetched));
+        // Subscriptions may have been edited meanwhile, so match by URL.
+        for (size_t i = 0; i < subs.size(); ++i) {
+            if (subs[i].url != ch.url) continue;
+            if (subs_cache.size() <= i) subs_cache.resize(i + 1);
+            if (!subs_cache[i].empty()) before = subs_cache[i];
+            subs_refresh->fresh[idx] = new_uploads(before, videos);
+            subs_cache[i] = videos;
+            break;
+        }
+        note_channel_state(ch.url);
+        if (!channel_url.empty() &&
+            cache_key_for_channel(channel_url) == cache_key_for_channel(ch.url)) {
+            apply_refreshed_head(channel_videos, channel_pager, videos, head,
+                                 focus == CHANNEL);
         }
-    } else {
-        video.title.assign(line, d1 + 3, std::string::npos);
     }
 
-    list.push_back(std::move(video));
+    ++subs_refresh_done;
+    if (subs_refresh_done == subs_refresh_total) {
+        finish_subs_refresh();
+        return;
+    }
+    set_status("Refreshing subscriptions " + std::to_string(subs_refresh_done) + "/" +
+               std::to_string(subs_refresh_total));
 }
 
 } // namespace
 
-std::vector<Video> fetch_videos(const std::string &source, int count) {
-    std::vector<Video> videos;
-    set_status("Fetching...");
+std::vector<Video> fetch_video_list(const std::string &source, int count) {
+    return read_listing(source, 0, count, nullptr, nullptr);
+}
 
-    if (count > MAX_LIST_ITEMS) count = MAX_LIST_ITEMS;
-    if (count > 0) videos.reserve(static_cast<size_t>(count));
+std::vector<Video> fetch_video_page(const std::string &source, size_t start, int count) {
+    return read_listing(source, start, count, nullptr, nullptr);
+}
 
-    Pipe pipe(build_fetch_command(source, count));
-    if (!pipe) {
-        set_status("Fetch failed");
-        return videos;
+bool page_loading() {
+    return (focus == RESULTS && res_pager.loading) ||
+           (focus == CHANNEL && channel_pager.loading);
+}
+
+void maybe_load_next_page() {
+    const bool is_res = focus == RESULTS;
+    if (!is_res && focus != CHANNEL) return;
+    const VideoList &list = is_res ? res : channel_videos;
+    Pager &pager = is_res ? res_pager : channel_pager;
+    const std::string &source = is_res ? res_source : channel_url;
+    if (source.empty() || list.empty() || pager.loading || pager.exhausted) return;
+    if (sel + PAGE_PREFETCH_MARGIN < list.size()) return;
+
+    pager.loading = true;
+    const size_t start = pager.next_start;
+    const unsigned gen = pager.gen;
+    run_async([is_res, source, start, gen]() {
+        std::vector<Video> page = fetch_video_page(source, start);
+        post_main([is_res, start, gen, page = std::move(page)]() {
+            Pager &p = is_res ? res_pager : channel_pager;
+            if (p.gen != gen) return;
+            p.loading = false;
+            p.next_start = start + page.size();
+            if (page.size() < static_cast<size_t>(MAX_LIST_ITEMS)) p.exhausted = true;
+            size_t added = append_page(is_res ? res : channel_videos, page);
+            if (added > 0) set_status("Loaded " + std::to_string(added) + " more");
+            // The user may already be past the new margin.
+            if (focus == (is_res ? RESULTS : CHANNEL)) maybe_load_next_page();
+        });
+    });
+}
+
+ChannelUpdate fetch_channel_update(const std::string &url, const std::vector<Video> &known) {
+    ChannelUpdate up;
+    if (!known.empty()) {
+        std::unordered_set<VideoId> ids;
+        for (const auto &v : known) ids.insert(v.id);
+        bool hit = false;
+        up.videos = read_listing(url, 0, CHANNEL_HEAD_WINDOW, &ids, &hit);
+        if (hit) {
+            up.fetched = true;
+            up.added = up.videos.size();
+            up.videos.insert(up.videos.end(), known.begin(), known.end());
+            if (up.videos.size() > CHANNEL_MAX_KEPT) up.videos.resize(CHANNEL_MAX_KEPT);
+            return up;
+        }
+        // An empty head means the fetch failed; keep what we have.
+        if (up.videos.empty()) {
+            up.videos = known;
+            return up;
+        }
+    }
+    up.full = true;
+    up.videos = fetch_video_list(url);
+    up.added = up.videos.size();
+    up.fetched = !up.videos.empty();
+    if (!up.fetched && !known.empty()) {
+        up.videos = known;
+        up.full = false;
     }
+    return up;
+}
 
-    std::string line;
-    while (read_line(pipe.get(), line)) {
-        append_video_from_line(videos, line);
+size_t refresh_channel_videos(const std::string &url, VideoList &list, bool active) {
+    std::string key = cache_key_for_channel(url);
+    if (list.empty()) {
+        std::vector<Video> cached;
+        time_t fetched = 0;
+        if (cache_load(key, cached, &fetched)) note_channel_state(url, fetched);
+        list = std::move(cached);
+    }
+    set_status("Fetching...");
+    ChannelUpdate up = fetch_channel_update(url, list);
+    if (!up.fetched) return 0;
+    cache_store(key, up.videos);
+    note_channel_state(url);
+    if (up.full) {
+        replace_keep_selection(list, std::move(up.videos), active);
+        if (&list == &channel_videos) reset_pager(channel_pager, list.size());
+        return up.added;
+    }
+    list = std::move(up.videos);
+    // The merged list is the head of the listing, possibly cut to
+    // CHANNEL_MAX_KEPT, so the next page starts right after it.
+    if (&list == &channel_videos) channel_pager.next_start = list.size();
+    // Only CHANNEL shows a channel listing, so its scroll moves with sel.
+    if (active && up.added > 0) {
+        sel = std::min(sel + up.added, list.size() - 1);
+        channel_scroll += up.added;
     }
+    return up.added;
+}
 
+std::vector<Video> fetch_videos(const std::string &source, int count) {
+    TraceSpan span("fetch_videos");
+    set_status("Fetching...");
+    std::vector<Video> videos = fetch_video_list(source, count);
     set_status("Found " + std::to_string(videos.size()) + " videos");
     return videos;
 }
 
+void run_search(const std::string &q) {
+    res_source = q;
+    std::string key = cache_key_for_query(q);
+    if (load_cached(key, q, res, false)) {
+        reset_pager(res_pager, res.size());
+        set_status("Found " + std::to_string(res.size()) + " videos (cached)");
+        return;
+    }
+    res = fetch_videos(q, MAX_LIST_ITEMS);
+    reset_pager(res_pager, res.size());
+    cache_store(key, res);
+}
+
+VideoList load_channel_videos(const std::string &url) {
+    VideoList videos;
+    if (load_cached(cache_key_for_channel(url), url, videos, true)) return videos;
+    videos = fetch_videos(url, MAX_LIST_ITEMS);
+    if (videos.empty()) return videos;
+    cache_store(cache_key_for_channel(url), videos);
+    note_channel_state(url);
+    return videos;
+}
+
 int spawn_background(const std::string &cmd) {
+    TraceSpan span("spawn_background");
     Pipe pipe(cmd + " >/dev/null 2>&1 & echo $!");
     if (!pipe) return -1;
 
@@ -126,13 +485,56 @@ int download(const Video &v) {
     ensure_video_cache();
 
     std::ostringstream cmd;
-    cmd << "yt-dlp -f \"" << YTDL_FMT
+    cmd << "'" << YTDLP_BIN << "' -f \"" << YTDL_FMT
         << "\" --restrict-filenames -o \"" << VIDEO_CACHE
         << "/%(title)s%(id)s.mkv\" \"https://www.youtube.com/watch?v="
-        << v.id << "\"";
+        << v.id.c_str() << "\"";
     return spawn_background(cmd.str());
 }
 
+void refresh_all_subscriptions() {
+    if (subs_refresh) {
+        set_status("Refresh already running");
+        return;
+    }
+    ensure_subs();
+    if (subs.empty()) {
+        set_status("No subscriptions to refresh");
+        return;
+    }
+
+    auto job = std::make_shared<SubsRefresh>();
+    job->channels = subs;
+    job->fresh.resize(subs.size());
+    subs_refresh = job;
+    subs_refresh_done = 0;
+    subs_refresh_total = subs.size();
+    set_status("Refreshing subscriptions 0/" + std::to_string(subs_refresh_total));
+
+    size_t workers = std::min(job->channels.size(), static_cast<size_t>(SUBS_REFRESH_CONCURRENCY));
+    for (size_t w = 0; w < workers; ++w) {
+        run_async([job]() {
+            for (;;) {
+                size_t idx = job->next.fetch_add(1);
+                if (idx >= job->channels.size()) break;
+                const std::string &url = job->channels[idx].url;
+                std::string key = cache_key_for_channel(url);
+                // Read the previous record before overwriting it; it is the
+                // baseline for "new" when the channel was never opened.
+                std::vector<Video> before;
+                cache_load(key, before);
+                ChannelUpdate up = fetch_channel_update(url, before);
+                std::vector<Video> videos;
+                if (up.fetched) videos = std::move(up.videos);
+                cache_store(key, videos);
+                post_main([idx, before = std::move(before), videos = std::move(videos)]() mutable {
+                    apply_subs_refresh(idx, std::move(before), std::move(videos));
+                });
+            }
+        });
+    }
+}
+
 void show_channel() {
     if(!res.empty() && sel < res.size()) {
         show_channel_for(res[sel]);
@@ -148,8 +550,21 @@ void show_channel() {
 }
 
 void show_channel_for(const Video &v) {
-    std::string url = v.channel_url;
-    if(url.empty() && !v.id.empty()) url = resolve_channel_url_for_video(v.id);
+    Video known = v;
+    if(known.channel_url.empty() && !known.id.empty() && !channel_map_fill(known)) {
+        // Look it up in the background; open it only if the user is still
+        // on the same entry by then.
+        set_status("Looking up channel...");
+        Focus from = focus;
+        size_t at = sel;
+        channel_map_resolve({known.id}, [known, from, at]() mutable {
+            if(focus != from || sel != at) return;
+            if(channel_map_fill(known)) show_channel_for(known);
+            else set_status("No channel URL available");
+        });
+        return;
+    }
+    std::string url = known.channel_url.str();
     if(url.empty()) {
         set_status("No channel URL available");
         return;
@@ -167,7 +582,7 @@ void show_channel_for(const Video &v) {
     enter_channel_view(url);
 }
 
-void enter_channel_view(const std::string &url, const std::vector<Video> *prefetched) {
+void enter_channel_view(const std::string &url, const VideoList *prefetched) {
     if(url.empty()) {
         set_status("No channel URL available");
         return;
@@ -177,8 +592,9 @@ void enter_channel_view(const std::string &url, const std::vector<Video> *prefet
     if(prefetched) {
         channel_videos = *prefetched;
     } else {
-        channel_videos = fetch_videos(url, MAX_LIST_ITEMS);
+        channel_videos = load_channel_videos(url);
     }
+    reset_pager(channel_pager, channel_videos.size());
     focus = CHANNEL;
     sel = 0;
     channel_scroll = 0;
@@ -190,14 +606,35 @@ void enter_channel_view(const std::string &url, const std::vector<Video> *prefet
         set_status("Inside a channel");
         show_thumbnail(channel_videos[sel]);
         preload_thumbnails(channel_videos, sel + 1);
+        maybe_load_next_page();
     }
 }
 
-std::string resolve_channel_url_for_video(const std::string &video_id) {
-    Pipe pipe("yt-dlp --no-warnings --print \"%(channel_url)s\" https://www.youtube.com/watch?v=" + video_id + " 2>/dev/null");
-    if (!pipe) return std::string();
-
-    std::string out;
-    if (!read_line(pipe.get(), out)) return std::string();
+std::vector<Video> resolve_video_channels(const std::vector<VideoId> &ids) {
+    std::vector<Video> out;
+    if (ids.empty()) return out;
+    TraceSpan span("resolve_video_channels");
+    std::string cmd = "'" + YTDLP_BIN + "' --no-warnings --ignore-errors --skip-download "
+                      "--print \"%(id)s|||%(channel_url)s|||%(channel)s\"";
+    for (const auto &id : ids) cmd += " \"https://www.youtube.com/watch?v=" + id.str() + "\"";
+    Pipe pipe(cmd + " 2>/dev/null");
+    if (!pipe) return out;
+
+    LineReader reader(fileno(pipe.get()));
+    std::string_view line;
+    while (reader.next(line)) {
+        size_t a = line.find("|||");
+        size_t b = a == std::string_view::npos ? a : line.find("|||", a + 3);
+        if (b == std::string_view::npos) continue;
+        Video v;
+        v.id = line.substr(0, a);
+        std::string_view url = line.substr(a + 3, b - a - 3);
+        std::string_view name = line.substr(b + 3);
+        // yt-dlp prints "NA" for fields it could not extract.
+        if (url.empty() || url == "NA") continue;
+        v.channel_url = url;
+        if (name != "NA") v.channel_name = name;
+        out.push_back(v);
+    }
     return out;
 }
@@ -7,12 +7,47 @@
 #include <vector>
 
 std::vector<Video> fetch_videos(const std::string &source, int count = MAX_LIST_ITEMS);
+// Same as fetch_videos() but without status updates; safe off the UI thread.
+std::vector<Video> fetch_video_list(const std::string &source, int count = MAX_LIST_ITEMS);
+// One page of a listing, starting at the 0-based entry `start`.
+std::vector<Video> fetch_video_page(const std::string &source, size_t start, int count = MAX_LIST_ITEMS);
+// Lazy pagination for RESULTS and CHANNEL: once the selection nears the end
+// of the list, the next page is fetched in the background and appended.
+void maybe_load_next_page();
+bool page_loading();
+// Cache-aware listings: cached results are returned at once and refreshed
+// in the background when stale; the refresh updates the views in place.
+void run_search(const std::string &q);
+VideoList load_channel_videos(const std::string &url);
+
+// Result of an incremental channel refresh: `added` new uploads were
+// prepended to the known list, or `full` when the list was refetched.
+// `fetched` is false when yt-dlp returned nothing and `videos` is just the
+// known list.
+struct ChannelUpdate {
+    std::vector<Video> videos;
+    size_t added = 0;
+    bool full = false;
+    bool fetched = false;
+};
+// Fetches a short head window, stopping at the first known id, and falls
+// back to a full listing when none is found. Safe off the UI thread.
+ChannelUpdate fetch_channel_update(const std::string &url, const std::vector<Video> &known);
+// Incrementally refresh `list`, keeping the selection on the same video
+// when the list is on screen. Returns the number of new uploads.
+size_t refresh_channel_videos(const std::string &url, VideoList &list, bool active);
+// Fetch every subscription in the background, SUBS_REFRESH_CONCURRENCY at a
+// time, refilling subs_cache and rebuilding feed_videos when done.
+void refresh_all_subscriptions();
 int download(const Video &v);
 int spawn_background(const std::string &cmd);
 // Actions
 void show_channel();
 void show_channel_for(const Video &v);
-void enter_channel_view(const std::string &url, const std::vector<Video> *prefetched = nullptr);
-std::string resolve_channel_url_for_video(const std::string &video_id);
+// Shows the channel's listing, or prefetched (shared, not copied) when given.
+void enter_channel_view(const std::string &url, const VideoList *prefetched = nullptr);
+// Channel URL and name for each id, one yt-dlp run for all of them. Ids
+// that could not be resolved are left out. Safe off the UI thread.
+std::vector<Video> resolve_video_channels(const std::vector<VideoId> &ids);
 
 #endif